@@ -86,7 +86,8 @@ void loop() {
     lastDiagnostics = currentTime;
   }
   
-  // Error handling is now automatic - no manual update needed
+  // Run learning and background maintenance off the transaction path
+  SmartWire.update();
   
   // Small delay to prevent overwhelming the system
   delay(100);
@@ -38,9 +38,14 @@ void setup() {
   
   Serial.println("Configuration complete.");
   
-  // Scan for I2C devices
+  // Scan for I2C devices, well inside the software watchdog period
   Serial.println("\nScanning I2C bus...");
-  SmartWire.scanAndOptimize();
+  BoundedRunResult scan = SmartWire.scanAndOptimize(2000);
+  if (!scan.completed) {
+    Serial.print("Optimization stopped at ");
+    Serial.print(scan.progress);
+    Serial.println("% - using best configuration found so far");
+  }
   
   Serial.println("\nSetup complete. Starting main loop...");
 }
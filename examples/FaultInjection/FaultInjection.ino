@@ -0,0 +1,70 @@
+/*
+ * Fault Injection Example for SelfAdjusting_I2C Library
+ * 
+ * Runs a scripted sequence of bus faults in front of a real device and
+ * reports how quickly the library's error handling and recovery bring the
+ * bus back, and how much throughput the faults cost.
+ * 
+ * Hardware: any board with one I2C device attached (set DEVICE_ADDRESS)
+ */
+
+#include "SelfAdjusting_I2C.h"
+
+const uint8_t DEVICE_ADDRESS = 0x48;
+
+// Two seconds of clean traffic first, so the report has a baseline rate
+const FaultStep scenario[] = {
+  // start ms, duration ms, fault,                 address, param
+  {  2000,      500,        FAULT_STUCK_SDA,         0,       0      },
+  {  5000,      2000,       FAULT_INTERMITTENT_NACK, 0,       20     },  // 20% of transactions
+  {  9000,      100,        FAULT_BURST_ERRORS,      0,       5      },  // 5 failures in a row
+  { 11000,      3000,       FAULT_CLOCK_STRETCH,     0,       300    },  // +300us per transaction
+  { 16000,      5000,       FAULT_SPEED_BIT_ERRORS,  0,       400000 }   // Errors above 400kHz
+};
+
+I2CFaultInjector injector;
+bool reported = false;
+
+void setup() {
+  Serial.begin(115200);
+  
+  SmartWire.begin();
+  SmartWire.enableLearning(true);
+  SmartWire.enableAdaptiveMode(true);
+  SmartWire.enableEmergencyRecovery(true);
+  
+  SmartWire.setFaultInjector(&injector);
+  injector.begin(scenario, sizeof(scenario) / sizeof(scenario[0]));
+  
+  Serial.println("Fault scenario started");
+}
+
+void loop() {
+  SmartWire.update();
+  
+  // Steady register reads
+  SmartWire.beginTransmission(DEVICE_ADDRESS);
+  SmartWire.write(0x00);
+  if (SmartWire.endTransmission(false) == 0) {
+    SmartWire.requestFrom(DEVICE_ADDRESS, (uint8_t)2);
+    while (SmartWire.available()) {
+      SmartWire.read();
+    }
+  }
+  
+  // Allow a few seconds after the last window for recovery before reporting
+  static unsigned long finishedAt = 0;
+  if (!reported && injector.isFinished()) {
+    if (finishedAt == 0) {
+      finishedAt = millis();
+    } else if (millis() - finishedAt > 3000) {
+      injector.printReport();
+      SmartWire.printDecisionLog();
+      injector.stop();
+      SmartWire.setFaultInjector(nullptr);
+      reported = true;
+    }
+  }
+  
+  delay(2);
+}
@@ -0,0 +1,202 @@
+/*
+ * Optimizer Stability Harness for SelfAdjusting_I2C Library
+ * 
+ * Runs many randomised scenarios against a device simulated by the fault
+ * injector and checks properties of the tuning loop:
+ *   - converges: no configuration change after MAX_CONVERGENCE_TRANSACTIONS
+ *   - no oscillation: at most MAX_DIRECTION_FLIPS clock direction reversals
+ *   - respects the device limit: never above the simulated maximum clock for
+ *     more than MAX_OVER_LIMIT_RUN consecutive transactions
+ * 
+ * Each scenario draws a simulated maximum clock (speed-dependent bit errors
+ * above it), a background NACK rate, an adaptation rate and a cooldown from
+ * its seed. Only limits below the platform's maximum clock are drawn, so the
+ * optimizer can always overshoot them. Failing and worst-case scenarios are
+ * printed with their seed so they can be replayed with REPLAY_SEED.
+ * 
+ * Hardware: any board; nothing needs to be attached to the I2C pins
+ */
+
+#include "SelfAdjusting_I2C.h"
+
+const uint8_t DEVICE_ADDRESS = 0x48;   // Simulated, not on the bus
+
+const uint16_t SCENARIOS = 1000;
+const uint16_t TRANSACTIONS_PER_SCENARIO = 3000;
+const uint16_t MAX_CONVERGENCE_TRANSACTIONS = 2000;
+const uint8_t MAX_DIRECTION_FLIPS = 6;
+const uint16_t MAX_OVER_LIMIT_RUN = 50;
+const uint32_t REPLAY_SEED = 0;        // Non-zero: run only this scenario
+
+const uint32_t DEVICE_LIMITS[] = { 100000, 400000, 1000000 };
+
+struct ScenarioResult {
+  uint32_t seed;
+  uint32_t deviceLimit;
+  uint8_t nackPercent;
+  uint16_t lastChange;         // Transaction index of the last configuration change
+  uint8_t flips;
+  uint16_t longestOverLimit;
+  uint32_t finalClock;
+};
+
+I2CFaultInjector injector;
+uint8_t limitCount;            // DEVICE_LIMITS entries below the platform's maximum clock
+
+// Tracked from the configuration change hook
+volatile uint16_t transactionIndex;
+volatile uint16_t lastChange;
+volatile uint8_t flips;
+volatile int8_t lastDirection;
+
+void onConfigChanged(uint32_t oldClock, uint16_t, uint32_t newClock, uint16_t) {
+  lastChange = transactionIndex;
+  if (newClock == oldClock) return;
+  
+  int8_t direction = (newClock > oldClock) ? 1 : -1;
+  if (lastDirection != 0 && direction != lastDirection) flips++;
+  lastDirection = direction;
+}
+
+ScenarioResult runScenario(uint32_t seed) {
+  ScenarioResult result;
+  randomSeed(seed);
+  
+  result.seed = seed;
+  result.deviceLimit = DEVICE_LIMITS[random(limitCount)];
+  result.nackPercent = random(4);
+  
+  // Start every scenario from the same state so a seed replays on its own:
+  // dropping the device config clears its gap, gap strikes, latency and
+  // adaptive-timeout statistics; it is re-added on its first answer
+  SmartWire.resetToDefaults();
+  SmartWire.resetLearning();
+  SmartWire.removeDeviceConfig(DEVICE_ADDRESS);
+  SmartWire.clearDecisionLog();
+  SmartWire.setAdaptationRate(random(1, 11));
+  SmartWire.setCooldownPeriod(random(0, 500));
+  
+  FaultStep faults[] = {
+    { 0, 0x7FFFFFFF, FAULT_SPEED_BIT_ERRORS, 0, result.deviceLimit },
+    { 0, 0x7FFFFFFF, FAULT_INTERMITTENT_NACK, 0, result.nackPercent }
+  };
+  injector.begin(faults, 2);
+  
+  transactionIndex = 0;
+  lastChange = 0;
+  flips = 0;
+  lastDirection = 0;
+  uint16_t overLimitRun = 0;
+  result.longestOverLimit = 0;
+  
+  for (uint16_t i = 0; i < TRANSACTIONS_PER_SCENARIO; i++) {
+    transactionIndex = i;
+    SmartWire.update();
+    
+    SmartWire.beginTransmission(DEVICE_ADDRESS);
+    SmartWire.write(0x00);
+    SmartWire.endTransmission();
+    
+    if (SmartWire.getClockSpeed() > result.deviceLimit) {
+      overLimitRun++;
+      if (overLimitRun > result.longestOverLimit) result.longestOverLimit = overLimitRun;
+    } else {
+      overLimitRun = 0;
+    }
+  }
+  
+  injector.stop();
+  result.lastChange = lastChange;
+  result.flips = flips;
+  result.finalClock = SmartWire.getClockSpeed();
+  return result;
+}
+
+bool passes(const ScenarioResult& r) {
+  return r.lastChange <= MAX_CONVERGENCE_TRANSACTIONS &&
+         r.flips <= MAX_DIRECTION_FLIPS &&
+         r.longestOverLimit <= MAX_OVER_LIMIT_RUN;
+}
+
+void printScenario(const char* label, const ScenarioResult& r) {
+  Serial.print(label);
+  Serial.print(" seed ");
+  Serial.print(r.seed);
+  Serial.print(": limit ");
+  Serial.print(r.deviceLimit);
+  Serial.print(" Hz, NACK ");
+  Serial.print(r.nackPercent);
+  Serial.print("%, last change @");
+  Serial.print(r.lastChange);
+  Serial.print(", flips ");
+  Serial.print(r.flips);
+  Serial.print(", over-limit run ");
+  Serial.print(r.longestOverLimit);
+  Serial.print(", final ");
+  Serial.print(r.finalClock);
+  Serial.println(" Hz");
+}
+
+void setup() {
+  Serial.begin(115200);
+  delay(1000);
+  
+  SmartWire.begin();
+  SmartWire.onConfigChange(onConfigChanged);
+  SmartWire.setFaultInjector(&injector);
+  injector.simulateDevice(DEVICE_ADDRESS);
+  
+  uint32_t maxClock = SelfAdjustingI2C::getPlatformCapabilities().maxClockSpeed;
+  limitCount = 0;
+  while (limitCount < sizeof(DEVICE_LIMITS) / sizeof(DEVICE_LIMITS[0]) &&
+         DEVICE_LIMITS[limitCount] < maxClock) {
+    limitCount++;
+  }
+  if (limitCount == 0) {
+    Serial.println("No device limit below the platform's maximum clock");
+    return;
+  }
+  
+  if (REPLAY_SEED != 0) {
+    ScenarioResult r = runScenario(REPLAY_SEED);
+    printScenario(passes(r) ? "PASS" : "FAIL", r);
+    SmartWire.printDecisionLog();
+    return;
+  }
+  
+  uint16_t failures = 0;
+  ScenarioResult slowest, flippiest, mostOverLimit;
+  slowest.lastChange = 0;
+  flippiest.flips = 0;
+  mostOverLimit.longestOverLimit = 0;
+  
+  for (uint16_t i = 0; i < SCENARIOS; i++) {
+    ScenarioResult r = runScenario(i + 1);
+    
+    if (!passes(r)) {
+      failures++;
+      printScenario("FAIL", r);
+    }
+    if (i == 0 || r.lastChange > slowest.lastChange) slowest = r;
+    if (i == 0 || r.flips > flippiest.flips) flippiest = r;
+    if (i == 0 || r.longestOverLimit > mostOverLimit.longestOverLimit) mostOverLimit = r;
+    
+    yield();
+  }
+  
+  Serial.println("=== Stability Harness Report ===");
+  Serial.print("Scenarios: ");
+  Serial.print(SCENARIOS);
+  Serial.print(", failures: ");
+  Serial.println(failures);
+  printScenario("Slowest convergence", slowest);
+  printScenario("Most oscillation", flippiest);
+  printScenario("Longest over limit", mostOverLimit);
+  Serial.println("================================");
+  
+  injector.simulateDevice(0);
+  SmartWire.setFaultInjector(nullptr);
+}
+
+void loop() {
+}
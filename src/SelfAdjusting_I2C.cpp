@@ -1,8 +1,17 @@
 #include "SelfAdjusting_I2C.h"
 #include <math.h>
 
+#if defined(ESP32)
+#include "driver/gpio.h"
+#elif defined(ARDUINO_ARCH_RP2040)
+#include "hardware/gpio.h"
+#endif
+
 // Global instance definition
 SelfAdjustingI2C SmartWire;
+#ifdef SAI2C_TWOWIRE_CTOR_ARGS
+SelfAdjustingTwoWire SmartTwoWire(SmartWire);
+#endif
 
 // Implementation of remaining functions
 
@@ -11,10 +20,7 @@ void SelfAdjustingI2C::forceOptimization() {
     lastAdjustmentTime = 0;
     
     if (currentConfig.metrics.successfulTransactions > 0) {
-        AIDecision decision = analyzePerformanceAndDecide();
-        if (decision.shouldAdjust) {
-            applyAIDecision(decision);
-        }
+        runLearningCycle();
     }
 }
 
@@ -30,6 +36,7 @@ void SelfAdjustingI2C::resetToDefaults() {
     
     // Clear metrics
     memset(&currentConfig.metrics, 0, sizeof(I2CPerformanceMetrics));
+    resetLatencyWindow();
     currentConfig.metrics.lastUpdateTime = millis();
     
     // Reset state variables
@@ -63,6 +70,7 @@ void SelfAdjustingI2C::resetLearning() {
     
     // Reset metrics but keep current configuration
     memset(&currentConfig.metrics, 0, sizeof(I2CPerformanceMetrics));
+    resetLatencyWindow();
     currentConfig.metrics.lastUpdateTime = millis();
     
     // Reset AI variables
@@ -74,6 +82,9 @@ void SelfAdjustingI2C::resetLearning() {
     // Clear error history
     memset(errorHistory, 0, sizeof(errorHistory));
     errorHistoryIndex = 0;
+    
+    // Forget which steps were good or bad
+    clearStepScores();
 }
 
 void SelfAdjustingI2C::setClockSpeed(uint32_t clockSpeed) {
@@ -96,6 +107,48 @@ void SelfAdjustingI2C::setRiseTime(uint16_t riseTimeNs) {
     }
 }
 
+uint8_t SelfAdjustingI2C::sortLatencyWindow(uint16_t* sorted) const {
+    uint8_t count = latencyWindow.count;
+    memcpy(sorted, latencyWindow.samples, count * sizeof(uint16_t));
+    
+    // Insertion sort - the window is tiny
+    for (uint8_t i = 1; i < count; i++) {
+        uint16_t value = sorted[i];
+        uint8_t j = i;
+        while (j > 0 && sorted[j - 1] > value) {
+            sorted[j] = sorted[j - 1];
+            j--;
+        }
+        sorted[j] = value;
+    }
+    return count;
+}
+
+uint32_t SelfAdjustingI2C::getMedianTransactionTime() const {
+    uint16_t sorted[LATENCY_WINDOW_SIZE];
+    uint8_t count = sortLatencyWindow(sorted);
+    if (count == 0) return currentConfig.metrics.averageTransactionTime;
+    
+    if (count & 1) {
+        return sorted[count / 2];
+    }
+    return ((uint32_t)sorted[count / 2 - 1] + sorted[count / 2]) / 2;
+}
+
+uint32_t SelfAdjustingI2C::getRobustTransactionTime() const {
+    uint16_t sorted[LATENCY_WINDOW_SIZE];
+    uint8_t count = sortLatencyWindow(sorted);
+    if (count == 0) return currentConfig.metrics.averageTransactionTime;
+    
+    // Drop the fastest and slowest quarter, average the rest
+    uint8_t trim = count / 4;
+    uint32_t sum = 0;
+    for (uint8_t i = trim; i < count - trim; i++) {
+        sum += sorted[i];
+    }
+    return sum / (count - 2 * trim);
+}
+
 I2CPerformanceMetrics SelfAdjustingI2C::getDeviceMetrics(uint8_t address) const {
     DeviceConfig* deviceConfig = const_cast<SelfAdjustingI2C*>(this)->findDeviceConfig(address);
     if (deviceConfig != nullptr) {
@@ -108,25 +161,51 @@ I2CPerformanceMetrics SelfAdjustingI2C::getDeviceMetrics(uint8_t address) const
     return emptyMetrics;
 }
 
-void SelfAdjustingI2C::scanAndOptimize() {
+bool SelfAdjustingI2C::isDevicePresent(uint8_t address) const {
+    DeviceConfig* deviceConfig = const_cast<SelfAdjustingI2C*>(this)->findDeviceConfig(address);
+    return deviceConfig != nullptr && deviceConfig->isPresent;
+}
+
+BoundedRunResult SelfAdjustingI2C::scanAndOptimize(uint32_t maxRunTimeMs) {
+    beginBoundedRun(maxRunTimeMs);
+    
     // Scan I2C bus for devices
-    uint8_t devicesFound = scanBus();
+    uint8_t devicesFound = scanAddresses();
+    bool scanCompleted = (lastRunResult.progress == 100);
     
-    if (devicesFound == 0) {
-        return; // No devices to optimize for
+    if (!scanCompleted || devicesFound == 0) {
+        lastRunResult.progress /= 10;
+        endBoundedRun(scanCompleted);
+        return lastRunResult; // Out of time, or no devices to optimize for
     }
     
     // Test different configurations and find the best overall performance
     I2CConfig originalConfig = currentConfig;
     I2CConfig bestOverallConfig = currentConfig;
     float bestOverallScore = 0.0;
+    bool completed = true;
     
-    // Test each step combination for optimal performance
-    for (uint8_t clockStep = 0; clockStep < DYNAMIC_RANGE_STEPS; clockStep++) {
-        for (uint8_t riseStep = 0; riseStep < DYNAMIC_RANGE_STEPS; riseStep++) {
+    // Rise-time steps are only worth testing where the core applies them
+    uint8_t riseFirst = 0;
+    uint8_t riseLast = DYNAMIC_RANGE_STEPS - 1;
+#if !SAI2C_HAS_RISE_TIME_CONTROL
+    riseFirst = riseLast = currentConfig.riseTimeStep;
+#endif
+    uint8_t riseCount = riseLast - riseFirst + 1;
+    
+    // Test each step combination for optimal performance; the scan counted as the first 10%
+    for (uint8_t clockStep = 0; clockStep <= maxClockStep && completed; clockStep++) {
+        for (uint8_t riseStep = riseFirst; riseStep <= riseLast; riseStep++) {
+            if (!continueBoundedRun()) {
+                completed = false;
+                break;
+            }
+            lastRunResult.progress = 10 + (uint16_t)(clockStep * riseCount + riseStep - riseFirst) * 90 /
+                                          (DYNAMIC_RANGE_STEPS * riseCount);
+            
             if (testConfiguration(clockStep, riseStep)) {
-                float score = calculatePerformanceScore(currentConfig.metrics);
-                if (score > bestOverallScore) {
+                float score = calculateSnapshotScore(currentConfig.metrics);
+                if (score > 0.0 && score >= bestOverallScore) {
                     bestOverallScore = score;
                     bestOverallConfig = currentConfig;
                 }
@@ -134,10 +213,226 @@ void SelfAdjustingI2C::scanAndOptimize() {
         }
     }
     
-    // Apply best configuration found
+    // Apply best configuration found, also when stopped early
     currentConfig = bestOverallConfig;
     applyConfiguration();
     saveCurrentAsBest();
+    
+    endBoundedRun(completed);
+    return lastRunResult;
+}
+
+void SelfAdjustingI2C::update() {
+    // From now on transactions only do accounting; learning runs here
+    updateDriven = true;
+    
+    serviceBackgroundOptimization();
+    
+    uint32_t now = millis();
+    if (now - lastUpdateTick < UPDATE_INTERVAL_MS) {
+        return;
+    }
+    lastUpdateTick = now;
+    
+    // Resume learning once the emergency recovery cooldown has expired
+    if (learningSuspended && now - lastAdjustmentTime >= adjustmentCooldown) {
+        learningSuspended = false;
+        learningMode = true;
+        adjustmentCooldown = 5000;
+    }
+    
+    performanceScore = calculatePerformanceScore(currentConfig.metrics);
+    
+    if (now - lastHistoryRollover >= HISTORY_INTERVAL_MS) {
+        lastHistoryRollover = now;
+        shiftPerformanceHistory();
+        trendAnalysis = analyzeTrend();
+    }
+    
+    if (!learningMode || isOptimizing()) {
+        return;
+    }
+    
+    // Learn only from a fresh window; an unchanged one would be scored again every tick
+    uint32_t totalTransactions = currentConfig.metrics.successfulTransactions +
+                                currentConfig.metrics.failedTransactions;
+    if (totalTransactions < learnedTransactions) {
+        learnedTransactions = 0; // Metrics were reset by a step change
+    }
+    if (totalTransactions - learnedTransactions >= PERFORMANCE_SAMPLES &&
+        now - lastAdjustmentTime >= adjustmentCooldown) {
+        runLearningCycle();
+        learnedTransactions = currentConfig.metrics.successfulTransactions +
+                              currentConfig.metrics.failedTransactions;
+    }
+    
+    if (now - lastMarginProbe >= MARGIN_PROBE_INTERVAL_MS) {
+        lastMarginProbe = now;
+        runMarginProbe();
+    }
+    
+    // Track pull-up/capacitance drift; only the ceiling moves, learning keeps its place
+    if (riseMeasureInterval != 0 && now - lastRiseMeasurement >= riseMeasureInterval) {
+        lastRiseMeasurement = now;
+        uint16_t riseTime = measureRiseTime(riseSdaPin, riseSclPin);
+        if (riseTime != 0) {
+            modelMaxClockSpeed = predictMaxClockSpeed(riseTime);
+            updateClockCeiling();
+        }
+    }
+}
+
+void SelfAdjustingI2C::runMarginProbe() {
+    // Only probe headroom from a clean, known configuration
+    if (deviceCount == 0 || consecutiveErrors > 0 || currentConfig.metrics.errorRate > 0) {
+        return;
+    }
+    
+    uint8_t probeStep = currentConfig.clockSpeedStep + 1;
+    if (probeStep > maxClockStep || isClockStepKnownBad(probeStep)) {
+        return;
+    }
+    
+    // testConfiguration() records the result in the step score table
+    I2CConfig servingConfig = currentConfig;
+    testConfiguration(probeStep, currentConfig.riseTimeStep);
+    currentConfig = servingConfig;
+    applyConfiguration();
+}
+
+void SelfAdjustingI2C::beginBackgroundOptimization(uint32_t budgetMicros) {
+    memset(&scanState, 0, sizeof(scanState));
+    scanState.phase = SCAN_DISCOVER;
+    scanState.nextAddress = 1;
+    scanState.budgetMicros = budgetMicros;
+    scanState.bestConfig = currentConfig;
+    scanState.riseLast = DYNAMIC_RANGE_STEPS - 1;
+#if !SAI2C_HAS_RISE_TIME_CONTROL
+    scanState.riseFirst = scanState.riseLast = currentConfig.riseTimeStep;
+#endif
+    scanState.riseStep = scanState.riseFirst;
+    
+    // Keep serving traffic at the safest clock while the sweep runs
+    currentConfig.clockSpeedStep = 0;
+    updateDynamicRange(clockSpeedRange, 0);
+    currentConfig.clockSpeed = clockSpeedRange.current_value;
+    applyConfiguration();
+}
+
+void SelfAdjustingI2C::cancelBackgroundOptimization() {
+    scanState.phase = SCAN_IDLE;
+}
+
+bool SelfAdjustingI2C::isOptimizing() const {
+    return scanState.phase == SCAN_DISCOVER || scanState.phase == SCAN_SWEEP;
+}
+
+uint8_t SelfAdjustingI2C::getOptimizationProgress() const {
+    // Discovery counts as the first 10%, the step sweep as the remaining 90%
+    switch (scanState.phase) {
+        case SCAN_DISCOVER:
+            return (uint8_t)((scanState.nextAddress * 10UL) / 127);
+        case SCAN_SWEEP: {
+            uint8_t riseCount = scanState.riseLast - scanState.riseFirst + 1;
+            uint16_t tested = (uint16_t)scanState.clockStep * riseCount + scanState.riseStep - scanState.riseFirst;
+            return 10 + (uint8_t)((tested * 90UL) / (DYNAMIC_RANGE_STEPS * riseCount));
+        }
+        case SCAN_COMPLETE:
+            return 100;
+        default:
+            return 0;
+    }
+}
+
+void SelfAdjustingI2C::serviceBackgroundOptimization() {
+    if (!isOptimizing()) {
+        return;
+    }
+    
+    // Always make progress, then keep probing until the time slice is used up
+    uint32_t startTime = micros();
+    do {
+        if (scanState.phase == SCAN_DISCOVER) {
+            backgroundDiscoverStep();
+        } else {
+            backgroundSweepStep();
+        }
+    } while (isOptimizing() && micros() - startTime < scanState.budgetMicros);
+}
+
+void SelfAdjustingI2C::backgroundDiscoverStep() {
+    uint8_t address = scanState.nextAddress++;
+    
+    wire->beginTransmission(address);
+    if (wire->endTransmission() == 0) {
+        if (findDeviceConfig(address) == nullptr) {
+            addDeviceConfig(address);
+        }
+        DeviceConfig* deviceConfig = findDeviceConfig(address);
+        if (deviceConfig != nullptr) {
+            deviceConfig->lastSucceeded = true;
+            if (!deviceConfig->isPresent) setDevicePresent(deviceConfig, true);
+        }
+        scanState.devicesFound++;
+    }
+    
+    if (scanState.nextAddress >= 127) {
+        if (scanState.devicesFound == 0) {
+            // Nothing to optimize for - stay at the safe clock
+            scanState.phase = SCAN_COMPLETE;
+        } else {
+            scanState.phase = SCAN_SWEEP;
+        }
+    }
+}
+
+void SelfAdjustingI2C::backgroundSweepStep() {
+    uint8_t clockStep = scanState.clockStep;
+    uint8_t riseStep = scanState.riseStep;
+    
+    // Advance to the next step pair before probing so progress is monotonic
+    if (++scanState.riseStep > scanState.riseLast) {
+        scanState.riseStep = scanState.riseFirst;
+        scanState.clockStep++;
+    }
+    
+    // Skip pairs already known to fail
+    if (!isStepKnownBad(clockStep, riseStep)) {
+        I2CConfig servingConfig = currentConfig;
+        
+        // Judge the step on its own probes; ties go to the later, faster step
+        if (testConfiguration(clockStep, riseStep)) {
+            float score = calculateSnapshotScore(currentConfig.metrics);
+            if (score > 0.0 && score >= scanState.bestScore) {
+                scanState.bestScore = score;
+                scanState.bestConfig = currentConfig;
+            }
+        }
+        scanState.probesDone++;
+        
+        // Go back to serving traffic at the safe configuration between probes
+        currentConfig = servingConfig;
+        applyConfiguration();
+    }
+    
+    if (scanState.clockStep > maxClockStep) {
+        finishBackgroundOptimization();
+    }
+}
+
+void SelfAdjustingI2C::finishBackgroundOptimization() {
+    scanState.phase = SCAN_COMPLETE;
+    
+    if (scanState.bestScore > 0.0) {
+        logDecision(REASON_BACKGROUND_SWEEP, 100, currentConfig.clockSpeedStep, currentConfig.riseTimeStep,
+                    scanState.bestScore, scanState.bestScore, 0.0, 0.0);
+
+        currentConfig = scanState.bestConfig;
+        updateDynamicRange(clockSpeedRange, currentConfig.clockSpeedStep);
+        updateDynamicRange(riseTimeRange, currentConfig.riseTimeStep);
+        applyConfiguration();
+        saveCurrentAsBest();
+    }
 }
 
 void SelfAdjustingI2C::setDeviceSpecificConfig(uint8_t address, uint32_t clockSpeed, uint16_t riseTime) {
@@ -166,16 +461,230 @@ void SelfAdjustingI2C::setDeviceSpecificConfig(uint8_t address, uint32_t clockSp
 void SelfAdjustingI2C::removeDeviceConfig(uint8_t address) {
     for (uint8_t i = 0; i < deviceCount; i++) {
         if (deviceConfigs[i].address == address) {
+            if (deviceConfigs[i].isPresent && deviceCallback != nullptr) {
+                deviceCallback(address, false);
+            }
+            setDeviceGap(&deviceConfigs[i], 0);
+            bool limited = deviceConfigs[i].maxClockSpeed != 0;
+            
             // Shift remaining configs down
             for (uint8_t j = i; j < deviceCount - 1; j++) {
                 deviceConfigs[j] = deviceConfigs[j + 1];
             }
             deviceCount--;
+            
+            if (limited) {
+                rebuildDynamicRanges();
+            }
             break;
         }
     }
 }
 
+bool SelfAdjustingI2C::setClockRange(uint32_t minHz, uint32_t maxHz) {
+    if (minHz == 0 || maxHz < minHz) return false;
+    
+    clockBoundMin = minHz;
+    clockBoundMax = maxHz;
+    rebuildDynamicRanges();
+    return true;
+}
+
+bool SelfAdjustingI2C::setRiseTimeRange(uint16_t minNs, uint16_t maxNs) {
+    if (maxNs < minNs) return false;
+    
+    riseBoundMin = minNs;
+    riseBoundMax = maxNs;
+    rebuildDynamicRanges();
+    return true;
+}
+
+void SelfAdjustingI2C::setDeviceMaxClockSpeed(uint8_t address, uint32_t maxHz) {
+    DeviceConfig* deviceConfig = findDeviceConfig(address);
+    if (deviceConfig == nullptr) {
+        addDeviceConfig(address);
+        deviceConfig = findDeviceConfig(address);
+    }
+    
+    if (deviceConfig != nullptr && deviceConfig->maxClockSpeed != maxHz) {
+        deviceConfig->maxClockSpeed = maxHz;
+        rebuildDynamicRanges();
+    }
+}
+
+DynamicRange SelfAdjustingI2C::getClockRange() const {
+    return clockSpeedRange;
+}
+
+DynamicRange SelfAdjustingI2C::getRiseTimeRange() const {
+    return riseTimeRange;
+}
+
+PlatformCapabilities SelfAdjustingI2C::getPlatformCapabilities() {
+    PlatformCapabilities caps;
+    caps.minClockSpeed = SAI2C_PLATFORM_MIN_CLOCK;
+    caps.maxClockSpeed = SAI2C_PLATFORM_MAX_CLOCK;
+    caps.riseTimeControl = SAI2C_HAS_RISE_TIME_CONTROL;
+#if defined(ESP32) || defined(ESP8266) || defined(WIRE_HAS_TIMEOUT)
+    caps.busTimeout = true;
+#else
+    caps.busTimeout = false;
+#endif
+#if defined(SAI2C_TIMING_DWT) || defined(SAI2C_TIMING_CPU_CYCLES)
+    caps.cycleCounter = true;
+#else
+    caps.cycleCounter = false;
+#endif
+    caps.maxPadLevel = SAI2C_MAX_PAD_LEVEL;
+    return caps;
+}
+
+void SelfAdjustingI2C::rebuildDynamicRanges() {
+    // Every device hears every transfer, so the slowest declared limit bounds the bus
+    uint32_t clockMax = clockBoundMax;
+    for (uint8_t i = 0; i < deviceCount; i++) {
+        if (deviceConfigs[i].maxClockSpeed != 0 && deviceConfigs[i].maxClockSpeed < clockMax) {
+            clockMax = deviceConfigs[i].maxClockSpeed;
+        }
+    }
+    uint32_t clockMin = min(clockBoundMin, clockMax);
+    
+    uint32_t oldClockSpeed = currentConfig.clockSpeed;
+    uint16_t oldRiseTime = currentConfig.riseTime;
+    
+    clockSpeedRange.min_value = clockMin;
+    clockSpeedRange.max_value = clockMax;
+    clockSpeedRange.default_value = constrain((uint32_t)DEFAULT_CLOCK_SPEED, clockMin, clockMax);
+    riseTimeRange.min_value = riseBoundMin;
+    riseTimeRange.max_value = riseBoundMax;
+    riseTimeRange.default_value = constrain((uint32_t)DEFAULT_RISE_TIME, (uint32_t)riseBoundMin, (uint32_t)riseBoundMax);
+    initializeDynamicRanges();
+    
+    // Move every configuration onto the new grid, rounding down to the safer step
+    snapConfigToRanges(currentConfig);
+    if (bestConfig.isValid) {
+        snapConfigToRanges(bestConfig);
+    }
+    for (uint8_t i = 0; i < deviceCount; i++) {
+        if (deviceConfigs[i].hasCustomConfig) {
+            snapConfigToRanges(deviceConfigs[i].config);
+        }
+    }
+    updateDynamicRange(clockSpeedRange, currentConfig.clockSpeedStep);
+    updateDynamicRange(riseTimeRange, currentConfig.riseTimeStep);
+    
+    // Scores and sweep positions refer to the old grid
+    memset(stepScoreTable, 0, sizeof(stepScoreTable));
+    cancelBackgroundOptimization();
+    
+    if (currentConfig.clockSpeed != oldClockSpeed || currentConfig.riseTime != oldRiseTime) {
+        memset(&currentConfig.metrics, 0, sizeof(I2CPerformanceMetrics));
+        resetLatencyWindow();
+        currentConfig.metrics.lastUpdateTime = millis();
+    }
+    
+    updateClockCeiling();
+    applyConfiguration();
+}
+
+void SelfAdjustingI2C::snapConfigToRanges(I2CConfig& config) {
+    config.clockSpeedStep = calculateStepFromValue(clockSpeedRange, config.clockSpeed);
+    config.riseTimeStep = calculateStepFromValue(riseTimeRange, config.riseTime);
+    config.clockSpeed = calculateValueFromStep(clockSpeedRange, config.clockSpeedStep);
+    config.riseTime = calculateValueFromStep(riseTimeRange, config.riseTimeStep);
+}
+
+void SelfAdjustingI2C::enableGapTuning(bool enable) {
+    gapTuning = enable;
+}
+
+void SelfAdjustingI2C::setTransactionGap(uint8_t address, uint16_t gapMicros) {
+    DeviceConfig* deviceConfig = findDeviceConfig(address);
+    if (deviceConfig == nullptr) {
+        addDeviceConfig(address);
+        deviceConfig = findDeviceConfig(address);
+    }
+    
+    if (deviceConfig != nullptr) {
+        setDeviceGap(deviceConfig, gapMicros);
+        deviceConfig->gapStrikes = 0;
+    }
+}
+
+uint16_t SelfAdjustingI2C::getTransactionGap(uint8_t address) const {
+    DeviceConfig* deviceConfig = const_cast<SelfAdjustingI2C*>(this)->findDeviceConfig(address);
+    return (deviceConfig != nullptr) ? deviceConfig->transactionGap : 0;
+}
+
+void SelfAdjustingI2C::enableAdaptiveTimeouts(bool enable) {
+    adaptiveTimeouts = enable;
+    if (!enable) {
+        applyBusTimeout(DEFAULT_TIMEOUT_MS * 1000UL);
+    }
+}
+
+uint32_t SelfAdjustingI2C::getDeviceTimeout(uint8_t address) const {
+    if (!adaptiveTimeouts) {
+        return DEFAULT_TIMEOUT_MS * 1000UL;
+    }
+    return calculateDeviceTimeout(const_cast<SelfAdjustingI2C*>(this)->findDeviceConfig(address));
+}
+
+void SelfAdjustingI2C::setDeviceGap(DeviceConfig* deviceConfig, uint16_t gapMicros) {
+    // Keep the count of gapped devices so startTransaction() can skip the lookup when there are none
+    if (deviceConfig->transactionGap == 0 && gapMicros > 0) gappedDeviceCount++;
+    if (deviceConfig->transactionGap > 0 && gapMicros == 0) gappedDeviceCount--;
+    deviceConfig->transactionGap = gapMicros;
+}
+
+bool SelfAdjustingI2C::handleGapFailure(uint8_t deviceAddress, I2CErrorType errorType) {
+    DeviceConfig* deviceConfig = findDeviceConfig(deviceAddress);
+    
+    // Only devices known to be there, and only while there is gap left to add
+    if (deviceConfig == nullptr || !deviceConfig->isPresent ||
+        deviceConfig->transactionGap >= TRANSACTION_GAP_MAX_US) {
+        return false;
+    }
+    
+    // Retry after the widest gap; if the device still fails, the gap is not the cause
+    uint32_t idle = micros() - lastStopMicros;
+    if (idle < TRANSACTION_GAP_MAX_US) {
+        delayMicroseconds(TRANSACTION_GAP_MAX_US - idle);
+    }
+    
+    uint8_t result = injectFault(deviceAddress);
+    if (result == 0 && !isSimulated(deviceAddress)) {
+        wire->beginTransmission(deviceAddress);
+        result = wire->endTransmission();
+    }
+    lastStopMicros = micros();
+    
+    if (result != 0) {
+        deviceConfig->gapStrikes = 0;
+        return false;
+    }
+    
+    // Counted in the metrics already; only the clock recovery in handleError() is skipped
+    deviceConfig->lastSucceeded = true;
+    lastError = errorType;
+    lastErrorTime = millis();
+    updateErrorHistory(errorType);
+    
+    if (errorCallback != nullptr) {
+        errorCallback(deviceAddress, errorType);
+    }
+    
+    if (++deviceConfig->gapStrikes >= TRANSACTION_GAP_STRIKES) {
+        deviceConfig->gapStrikes = 0;
+        setDeviceGap(deviceConfig, min((uint16_t)(deviceConfig->transactionGap + TRANSACTION_GAP_STEP_US),
+                                       (uint16_t)TRANSACTION_GAP_MAX_US));
+        logDecision(REASON_TRANSACTION_GAP, 70, currentConfig.clockSpeedStep, currentConfig.riseTimeStep,
+                    performanceScore, 0.0, trendAnalysis, getRecentErrorRate());
+    }
+    
+    return true;
+}
+
 void SelfAdjustingI2C::enableEmergencyRecovery(bool enable) {
     emergencyRecovery = enable;
 }
@@ -211,6 +720,16 @@ void SelfAdjustingI2C::printDiagnostics() const {
     Serial.print(currentConfig.metrics.averageTransactionTime);
     Serial.println(" μs");
     
+    Serial.print("Median / Trimmed Transaction Time: ");
+    Serial.print(getMedianTransactionTime());
+    Serial.print(" / ");
+    Serial.print(getRobustTransactionTime());
+    Serial.println(" μs");
+    
+    Serial.print("Timing Source: ");
+    Serial.println(timingSource == TIMING_CYCLE_COUNTER ? "Cycle counter" :
+                   timingSource == TIMING_HW_TIMER ? "Hardware timer" : "micros()");
+    
     Serial.print("Consecutive Errors: ");
     Serial.println(consecutiveErrors);
     
@@ -255,6 +774,12 @@ void SelfAdjustingI2C::printDeviceConfigs() const {
             Serial.print("Using global config");
         }
         
+        if (deviceConfigs[i].transactionGap > 0) {
+            Serial.print(", gap ");
+            Serial.print(deviceConfigs[i].transactionGap);
+            Serial.print(" us");
+        }
+        
         Serial.print(" | Success: ");
         Serial.print(deviceConfigs[i].config.metrics.successfulTransactions);
         Serial.print(", Fail: ");
@@ -271,6 +796,7 @@ bool SelfAdjustingI2C::testConfiguration(uint8_t clockStep, uint8_t riseStep) {
     
     // Save current configuration
     I2CConfig originalConfig = currentConfig;
+    probingConfiguration = true;
     
     // Apply test configuration
     currentConfig.clockSpeedStep = clockStep;
@@ -284,33 +810,31 @@ bool SelfAdjustingI2C::testConfiguration(uint8_t clockStep, uint8_t riseStep) {
     
     applyConfiguration();
     
-    // Perform test transactions with known devices
+    // Ping every device known to be on the bus; a single failure fails the step
     bool testPassed = true;
-    uint8_t testErrors = 0;
     
-    // Test with each known device
-    for (uint8_t i = 0; i < deviceCount && testPassed; i++) {
-        uint8_t address = deviceConfigs[i].address;
+    for (uint8_t i = 0; i < deviceCount; i++) {
+        if (!deviceConfigs[i].isPresent) {
+            continue; // An absent device says nothing about this step
+        }
         
-        // Simple ping test - try to start transmission
-        Wire.beginTransmission(address);
-        uint8_t result = Wire.endTransmission();
+        uint32_t startTicks = readTimingTicks();
+        wire->beginTransmission(deviceConfigs[i].address);
+        bool acked = (wire->endTransmission() == 0);
+        uint32_t probeTime = elapsedMicros(startTicks);
         
-        if (result != 0) {
-            testErrors++;
-            if (testErrors > 2) { // Allow some tolerance
-                testPassed = false;
-            }
-        } else {
+        if (acked) {
             currentConfig.metrics.successfulTransactions++;
+            currentConfig.metrics.totalTransactionTime += probeTime;
+            currentConfig.metrics.averageTransactionTime =
+                currentConfig.metrics.totalTransactionTime / currentConfig.metrics.successfulTransactions;
+        } else {
+            currentConfig.metrics.failedTransactions++;
+            testPassed = false;
         }
         
-        currentConfig.metrics.failedTransactions += testErrors;
-    }
-    
-    // If no devices to test with, assume configuration is valid
-    if (deviceCount == 0) {
-        testPassed = true;
+        // Every ping counts, so one failing device marks the step bad
+        recordStepResult(clockStep, riseStep, acked);
     }
     
     // Restore original configuration if test failed
@@ -318,18 +842,51 @@ bool SelfAdjustingI2C::testConfiguration(uint8_t clockStep, uint8_t riseStep) {
         currentConfig = originalConfig;
         applyConfiguration();
     }
+    probingConfiguration = false;
     
     return testPassed;
 }
 
-uint8_t SelfAdjustingI2C::scanBus() {
+uint8_t SelfAdjustingI2C::scanBus(uint32_t maxRunTimeMs) {
+    beginBoundedRun(maxRunTimeMs);
+    uint8_t devicesFound = scanAddresses();
+    endBoundedRun(lastRunResult.progress == 100);
+    return devicesFound;
+}
+
+BoundedRunResult SelfAdjustingI2C::getLastRunResult() const {
+    return lastRunResult;
+}
+
+void SelfAdjustingI2C::beginBoundedRun(uint32_t maxRunTimeMs) {
+    runStartMillis = millis();
+    runLimitMillis = maxRunTimeMs;
+    lastYieldMillis = runStartMillis;
+    memset(&lastRunResult, 0, sizeof(lastRunResult));
+}
+
+void SelfAdjustingI2C::endBoundedRun(bool completed) {
+    lastRunResult.completed = completed;
+    if (completed) lastRunResult.progress = 100;
+    lastRunResult.elapsedMillis = millis() - runStartMillis;
+}
+
+uint8_t SelfAdjustingI2C::scanAddresses() {
     uint8_t devicesFound = 0;
     
     Serial.println("Scanning I2C bus...");
     
     for (uint8_t address = 1; address < 127; address++) {
-        Wire.beginTransmission(address);
-        uint8_t error = Wire.endTransmission();
+        if (!continueBoundedRun()) {
+            Serial.print("Scan stopped by time limit at address 0x");
+            Serial.println(address, HEX);
+            lastRunResult.devicesFound = devicesFound;
+            return devicesFound;
+        }
+        lastRunResult.progress = (uint16_t)address * 100 / 127;
+        
+        wire->beginTransmission(address);
+        uint8_t error = wire->endTransmission();
         
         if (error == 0) {
             Serial.print("Device found at address 0x");
@@ -340,6 +897,11 @@ uint8_t SelfAdjustingI2C::scanBus() {
             if (findDeviceConfig(address) == nullptr) {
                 addDeviceConfig(address);
             }
+            DeviceConfig* deviceConfig = findDeviceConfig(address);
+            if (deviceConfig != nullptr) {
+                deviceConfig->lastSucceeded = true;
+                if (!deviceConfig->isPresent) setDevicePresent(deviceConfig, true);
+            }
             
             devicesFound++;
         }
@@ -349,6 +911,8 @@ uint8_t SelfAdjustingI2C::scanBus() {
     Serial.print(devicesFound);
     Serial.println(" devices.");
     
+    lastRunResult.devicesFound = devicesFound;
+    lastRunResult.progress = 100;
     return devicesFound;
 }
 
@@ -362,8 +926,8 @@ float SelfAdjustingI2C::analyzeTrend() {
     
     // Simple linear trend analysis
     for (uint8_t i = 1; i < samples; i++) {
-        float currentScore = calculatePerformanceScore(performanceHistory[i]);
-        float previousScore = calculatePerformanceScore(performanceHistory[i-1]);
+        float currentScore = calculateSnapshotScore(performanceHistory[i]);
+        float previousScore = calculateSnapshotScore(performanceHistory[i-1]);
         trend += (currentScore - previousScore);
     }
     
@@ -406,6 +970,67 @@ uint32_t SelfAdjustingI2C::measureTransactionTime() {
     return micros(); // Return current time as placeholder
 }
 
+void SelfAdjustingI2C::initTimingSource() {
+    timingSource = TIMING_MICROS;
+    timingTicksPerMicro = 1;
+    
+#if defined(SAI2C_TIMING_DWT)
+    // Enable trace, unlock the DWT (needed on Cortex-M7) and start the counter
+    SAI2C_DEMCR |= (1UL << 24);
+    SAI2C_DWT_LAR = 0xC5ACCE55;
+    SAI2C_DWT_CYCCNT = 0;
+    SAI2C_DWT_CTRL |= 1UL;
+    
+    // Some parts lack or lock the counter - only use it if it actually runs
+    uint32_t before = SAI2C_DWT_CYCCNT;
+    delayMicroseconds(2);
+    if (SAI2C_DWT_CYCCNT != before) {
+        timingSource = TIMING_CYCLE_COUNTER;
+#ifdef F_CPU
+        timingTicksPerMicro = F_CPU / 1000000UL;
+#else
+        timingTicksPerMicro = SystemCoreClock / 1000000UL;
+#endif
+    }
+#elif defined(SAI2C_TIMING_CPU_CYCLES)
+    timingSource = TIMING_CYCLE_COUNTER;
+    timingTicksPerMicro = ESP.getCpuFreqMHz();
+#elif defined(SAI2C_TIMING_AVR_TIMER1)
+    if (hardwareTimerRequested) {
+        // Timer1 free-running in normal mode with a /8 prescaler
+        TCCR1A = 0;
+        TCCR1B = (1 << CS11);
+        TIMSK1 = 0;
+        timingSource = TIMING_HW_TIMER;
+        timingTicksPerMicro = F_CPU / 8000000UL;
+    }
+#endif
+    
+    if (timingTicksPerMicro == 0) {
+        timingTicksPerMicro = 1;
+    }
+    
+    // Calibrate: the cheapest back-to-back read is pure measurement overhead
+    timingOverheadTicks = 0;
+    uint32_t minOverhead = 0xFFFFFFFF;
+    for (uint8_t i = 0; i < TIMING_CALIBRATION_SAMPLES; i++) {
+        uint32_t start = readTimingTicks();
+        uint32_t ticks = readTimingTicks() - start;
+        if (timingSource == TIMING_HW_TIMER) {
+            ticks &= 0xFFFF;
+        }
+        if (ticks < minOverhead) {
+            minOverhead = ticks;
+        }
+    }
+    timingOverheadTicks = minOverhead;
+}
+
+void SelfAdjustingI2C::enableHardwareTimerTiming(bool enable) {
+    hardwareTimerRequested = enable;
+    initTimingSource();
+}
+
 // These functions are replaced by calculateStepFromValue in the dynamic range system
 // uint8_t findClockSpeedIndex and uint8_t findRiseTimeIndex are no longer needed
 
@@ -421,9 +1046,9 @@ float SelfAdjustingI2C::calculateDeviceCompatibilityScore(uint8_t address) {
 
 void SelfAdjustingI2C::resetHardware() {
     // Reset I2C hardware to default state
-    Wire.end();
+    wire->end();
     delay(10);
-    Wire.begin();
+    wire->begin();
     
     // Apply current configuration
     applyConfiguration();
@@ -438,7 +1063,1372 @@ void SelfAdjustingI2C::shiftPerformanceHistory() {
         historyIndex = LEARNING_WINDOW_SIZE - 1;
     }
     
-    // Add current metrics to history
+    // Add current metrics to history, with the trimmed-mean latency so one stall can't skew the trend
     performanceHistory[historyIndex] = currentConfig.metrics;
+    performanceHistory[historyIndex].averageTransactionTime = getRobustTransactionTime();
     historyIndex++;
-}
\ No newline at end of file
+}
+void SelfAdjustingI2C::clearStepScores() {
+    memset(stepScoreTable, 0, sizeof(stepScoreTable));
+    lastStepScoreDecay = millis();
+}
+
+void SelfAdjustingI2C::recordStepResult(uint8_t clockStep, uint8_t riseStep, bool success) {
+    uint8_t score = getStepScore(clockStep, riseStep);
+    
+    if (score == STEP_SCORE_UNKNOWN) {
+        score = STEP_SCORE_NEUTRAL;
+    }
+    
+    if (success) {
+        // Successes build trust slowly
+        score = min(score + 1, STEP_SCORE_MAX);
+    } else {
+        // Failures weigh four successes, so one failure from neutral marks the step known-bad
+        score = (score > 4) ? score - 4 : 1;
+    }
+    
+    setStepScore(clockStep, riseStep, score);
+}
+
+uint16_t SelfAdjustingI2C::predictRiseTime(uint32_t pullUpOhms, uint16_t capacitancePf) {
+    // Ohms * pF = 1e-12 s; scale to ns
+    float riseTimeNs = BUS_MODEL_RISE_FACTOR * pullUpOhms * capacitancePf / 1000.0f;
+    return (riseTimeNs > 65535.0f) ? 65535 : (uint16_t)riseTimeNs;
+}
+
+uint32_t SelfAdjustingI2C::predictMaxClockSpeed(uint16_t riseTimeNs) {
+    // Fastest mode whose maximum rise time the bus meets (UM10204 Table 10)
+    if (riseTimeNs <= 40) return 3400000;    // Hs-mode 3.4MHz, Cb up to 100pF
+    if (riseTimeNs <= 80) return 1700000;    // Hs-mode 1.7MHz, Cb up to 400pF
+    if (riseTimeNs <= 120) return 1000000;   // Fast-mode Plus
+    if (riseTimeNs <= 300) return 400000;    // Fast-mode
+    if (riseTimeNs <= 1000) return 100000;   // Standard-mode
+    
+    // Beyond the spec: keep the rise time within the same share of the period
+    return (100000UL * 1000UL) / riseTimeNs;
+}
+
+uint32_t SelfAdjustingI2C::setBusModel(uint32_t pullUpOhms, uint16_t capacitancePf) {
+    return setBusModelFromRiseTime(predictRiseTime(pullUpOhms, capacitancePf));
+}
+
+uint32_t SelfAdjustingI2C::setBusModelFromRiseTime(uint16_t riseTimeNs) {
+    modelMaxClockSpeed = predictMaxClockSpeed(riseTimeNs);
+    updateClockCeiling();
+    
+    // Start learning at the prediction rather than climbing to it
+    currentConfig.clockSpeedStep = maxClockStep;
+    currentConfig.riseTimeStep = calculateStepFromValue(riseTimeRange, riseTimeNs);
+    updateDynamicRange(clockSpeedRange, currentConfig.clockSpeedStep);
+    updateDynamicRange(riseTimeRange, currentConfig.riseTimeStep);
+    currentConfig.clockSpeed = clockSpeedRange.current_value;
+    currentConfig.riseTime = riseTimeRange.current_value;
+    applyConfiguration();
+    
+    return modelMaxClockSpeed;
+}
+
+void SelfAdjustingI2C::clearBusModel() {
+    modelMaxClockSpeed = 0;
+    updateClockCeiling();
+}
+
+uint32_t SelfAdjustingI2C::getModelMaxClockSpeed() const {
+    return modelMaxClockSpeed;
+}
+
+uint8_t SelfAdjustingI2C::getMaxClockStep() const {
+    return maxClockStep;
+}
+
+uint16_t SelfAdjustingI2C::measureRiseTime(uint8_t sdaPin, uint8_t sclPin) {
+    if (timingSource != TIMING_CYCLE_COUNTER) {
+        return 0; // micros() and Timer1/8 are far too coarse for nanoseconds
+    }
+    
+    // Take the pins from the I2C peripheral while measuring
+    wire->end();
+    uint32_t sclTicks = measureLineRiseTicks(sclPin);
+    uint32_t sdaTicks = measureLineRiseTicks(sdaPin); // Low-high on SDA with SCL high is a START/STOP pair
+    wire->begin();
+    applyConfiguration();
+    uint32_t timeout = appliedTimeoutMicros;
+    appliedTimeoutMicros = 0; // begin() may have reset the core's timeout
+    applyBusTimeout(timeout ? timeout : DEFAULT_TIMEOUT_MS * 1000UL);
+    
+    uint32_t ticks = max(sclTicks, sdaTicks);
+    if (ticks == 0xFFFFFFFF) {
+        return 0; // A line never went high
+    }
+    if (ticks == 0) {
+        ticks = 1; // Faster than the polling loop resolves - report the resolution as an upper bound
+    }
+    
+    float riseTimeNs = (float)ticks * 1000.0f / timingTicksPerMicro * RISE_TIME_THRESHOLD_SCALE;
+    measuredRiseTime = (riseTimeNs > 65535.0f) ? 65535 : (uint16_t)riseTimeNs;
+    return measuredRiseTime;
+}
+
+uint32_t SelfAdjustingI2C::measureLineRiseTicks(uint8_t pin) {
+    uint32_t timeoutTicks = RISE_TIME_TIMEOUT_US * timingTicksPerMicro;
+    uint32_t bestRise = 0xFFFFFFFF;
+    uint32_t bestOverhead = 0xFFFFFFFF;
+    
+    // Minimum of several releases; interrupts off so only the line itself is timed
+    for (uint8_t i = 0; i < RISE_TIME_SAMPLES; i++) {
+        // Overhead: the same release-and-poll sequence on a line that is already high
+        pinMode(pin, INPUT);
+        delayMicroseconds(RISE_TIME_TIMEOUT_US);
+        noInterrupts();
+        uint32_t start = readTimingTicks();
+        pinMode(pin, INPUT);
+        while (!digitalRead(pin) && readTimingTicks() - start < timeoutTicks) {}
+        uint32_t overhead = readTimingTicks() - start;
+        interrupts();
+        bestOverhead = min(bestOverhead, overhead);
+        
+        // Rise: pull the line low, then release it to the pull-ups
+        digitalWrite(pin, LOW);
+        pinMode(pin, OUTPUT);
+        delayMicroseconds(5);
+        noInterrupts();
+        start = readTimingTicks();
+        pinMode(pin, INPUT);
+        while (!digitalRead(pin) && readTimingTicks() - start < timeoutTicks) {}
+        uint32_t rise = readTimingTicks() - start;
+        interrupts();
+        
+        if (rise >= timeoutTicks) {
+            return 0xFFFFFFFF;
+        }
+        bestRise = min(bestRise, rise);
+    }
+    
+    return (bestRise > bestOverhead) ? bestRise - bestOverhead : 0;
+}
+
+void SelfAdjustingI2C::enableRiseTimeMonitoring(uint8_t sdaPin, uint8_t sclPin, uint32_t intervalMs) {
+    riseSdaPin = sdaPin;
+    riseSclPin = sclPin;
+    riseMeasureInterval = intervalMs;
+    lastRiseMeasurement = millis();
+    
+    // First measurement also places learning at the prediction
+    uint16_t riseTime = measureRiseTime(sdaPin, sclPin);
+    if (riseTime != 0) {
+        setBusModelFromRiseTime(riseTime);
+    }
+}
+
+void SelfAdjustingI2C::disableRiseTimeMonitoring() {
+    riseMeasureInterval = 0;
+}
+
+uint16_t SelfAdjustingI2C::getMeasuredRiseTime() const {
+    return measuredRiseTime;
+}
+
+void SelfAdjustingI2C::enablePadTuning(uint8_t sdaPin, uint8_t sclPin, bool enable) {
+    bool newPins = (sdaPin != padSdaPin || sclPin != padSclPin);
+    padSdaPin = sdaPin;
+    padSclPin = sclPin;
+    
+    // Remember the driver's own pad setup once, before any level changes it
+    if (enable && (!padTuning || newPins)) {
+#if defined(ESP32)
+        gpio_drive_cap_t drive = GPIO_DRIVE_CAP_2;
+        gpio_get_drive_capability((gpio_num_t)padSdaPin, &drive);
+        padDriverDrive[0] = drive;
+        gpio_get_drive_capability((gpio_num_t)padSclPin, &drive);
+        padDriverDrive[1] = drive;
+#elif defined(ARDUINO_ARCH_RP2040)
+        padDriverDrive[0] = gpio_get_drive_strength(padSdaPin);
+        padDriverDrive[1] = gpio_get_drive_strength(padSclPin);
+        padDriverPullUp[0] = gpio_is_pulled_up(padSdaPin);
+        padDriverPullUp[1] = gpio_is_pulled_up(padSclPin);
+#endif
+    }
+    
+    padTuning = enable && SAI2C_MAX_PAD_LEVEL > 0;
+    if (padTuning) {
+        applyPadConfiguration();
+    }
+}
+
+void SelfAdjustingI2C::setPadLevel(uint8_t level) {
+    padLevel = min(level, (uint8_t)SAI2C_MAX_PAD_LEVEL);
+    if (padTuning) {
+        applyPadConfiguration();
+    }
+}
+
+uint8_t SelfAdjustingI2C::getPadLevel() const {
+    return padLevel;
+}
+
+bool SelfAdjustingI2C::strengthenPads() {
+#if SAI2C_MAX_PAD_LEVEL > 0
+    if (!padTuning || padLevel >= SAI2C_MAX_PAD_LEVEL) {
+        return false;
+    }
+    
+    padLevel++;
+    applyPadConfiguration();
+    
+    // Judge the new pad setting on fresh metrics, as after a step change
+    lastAdjustmentTime = millis();
+    memset(&currentConfig.metrics, 0, sizeof(I2CPerformanceMetrics));
+    resetLatencyWindow();
+    currentConfig.metrics.lastUpdateTime = millis();
+    return true;
+#else
+    return false;
+#endif
+}
+
+void SelfAdjustingI2C::applyPadConfiguration() {
+#if defined(ESP32)
+    // Level 0 is the driver's setup. Its pull-ups can't be read back, so they are never turned off
+    if (padLevel == 0) {
+        gpio_set_drive_capability((gpio_num_t)padSdaPin, (gpio_drive_cap_t)padDriverDrive[0]);
+        gpio_set_drive_capability((gpio_num_t)padSclPin, (gpio_drive_cap_t)padDriverDrive[1]);
+        return;
+    }
+    
+    // Internal pull-ups are ~45k: a small but free help to the rise time
+    uint8_t drive = (padLevel >= 2) ? GPIO_DRIVE_CAP_3 : GPIO_DRIVE_CAP_2;
+    gpio_pullup_en((gpio_num_t)padSdaPin);
+    gpio_pullup_en((gpio_num_t)padSclPin);
+    gpio_set_drive_capability((gpio_num_t)padSdaPin, (gpio_drive_cap_t)max(drive, padDriverDrive[0]));
+    gpio_set_drive_capability((gpio_num_t)padSclPin, (gpio_drive_cap_t)max(drive, padDriverDrive[1]));
+#elif defined(ARDUINO_ARCH_RP2040)
+    // Level 0 is the driver's setup, pull-ups included
+    if (padLevel == 0) {
+        gpio_set_pulls(padSdaPin, padDriverPullUp[0], false);
+        gpio_set_pulls(padSclPin, padDriverPullUp[1], false);
+        gpio_set_drive_strength(padSdaPin, (gpio_drive_strength)padDriverDrive[0]);
+        gpio_set_drive_strength(padSclPin, (gpio_drive_strength)padDriverDrive[1]);
+        return;
+    }
+    
+    // Internal pull-ups are 50-80k; drive strength sharpens the falling edges
+    static const uint8_t drives[] = {
+        GPIO_DRIVE_STRENGTH_4MA, GPIO_DRIVE_STRENGTH_4MA, GPIO_DRIVE_STRENGTH_8MA, GPIO_DRIVE_STRENGTH_12MA
+    };
+    gpio_pull_up(padSdaPin);
+    gpio_pull_up(padSclPin);
+    gpio_set_drive_strength(padSdaPin, (gpio_drive_strength)max(drives[padLevel], padDriverDrive[0]));
+    gpio_set_drive_strength(padSclPin, (gpio_drive_strength)max(drives[padLevel], padDriverDrive[1]));
+#else
+    // No pad control on this platform
+#endif
+}
+
+void SelfAdjustingI2C::updateClockCeiling() {
+    maxClockStep = DYNAMIC_RANGE_STEPS - 1;
+    
+    if (modelMaxClockSpeed != 0) {
+        // Highest step whose clock does not exceed the prediction
+        uint8_t step = calculateStepFromValue(clockSpeedRange, modelMaxClockSpeed);
+        while (step > 0 && calculateValueFromStep(clockSpeedRange, step) > modelMaxClockSpeed) {
+            step--;
+        }
+        maxClockStep = step;
+    }
+    
+    // Leave any configuration that is now out of bounds
+    if (currentConfig.clockSpeedStep > maxClockStep) {
+        currentConfig.clockSpeedStep = maxClockStep;
+        updateDynamicRange(clockSpeedRange, maxClockStep);
+        currentConfig.clockSpeed = clockSpeedRange.current_value;
+        applyConfiguration();
+    }
+}
+
+uint8_t SelfAdjustingI2C::selectClockStep(uint8_t fromStep, int8_t delta, uint8_t riseStep) const {
+    if (delta > 0) {
+        // Never climb into a clock step that is known to fail at any rise time,
+        // or above the modelled ceiling
+        if (fromStep >= maxClockStep || isClockStepKnownBad(fromStep + 1)) {
+            return fromStep;
+        }
+        
+        // Skip straight past steps already proven good
+        uint8_t step = fromStep + 1;
+        while (step < maxClockStep && isStepKnownGood(step, riseStep) &&
+               !isClockStepKnownBad(step + 1)) {
+            step++;
+        }
+        return step;
+    }
+    
+    if (delta < 0) {
+        if (fromStep == 0) {
+            return 0;
+        }
+        
+        // Prefer the fastest known-good step below the current one
+        for (int8_t step = fromStep - 1; step >= 0; step--) {
+            if (isStepKnownGood(step, riseStep)) {
+                return step;
+            }
+        }
+        
+        // Otherwise take the next lower step that isn't known to fail
+        uint8_t step = fromStep - 1;
+        while (step > 0 && isClockStepKnownBad(step)) {
+            step--;
+        }
+        return step;
+    }
+    
+    return fromStep;
+}
+
+void SelfAdjustingI2C::decayStepScores() {
+    uint32_t now = millis();
+    if (now - lastStepScoreDecay < STEP_SCORE_DECAY_MS) {
+        return;
+    }
+    lastStepScoreDecay = now;
+    
+    // Move every known score one point towards neutral so old verdicts expire
+    for (uint8_t clockStep = 0; clockStep < DYNAMIC_RANGE_STEPS; clockStep++) {
+        for (uint8_t riseStep = 0; riseStep < DYNAMIC_RANGE_STEPS; riseStep++) {
+            uint8_t score = getStepScore(clockStep, riseStep);
+            if (score == STEP_SCORE_UNKNOWN || score == STEP_SCORE_NEUTRAL) continue;
+            setStepScore(clockStep, riseStep, score < STEP_SCORE_NEUTRAL ? score + 1 : score - 1);
+        }
+    }
+}
+
+FifoDrainResult SelfAdjustingI2C::drainFifo(const FifoConfig& fifo, SampleRing& ring, uint16_t maxSamples) {
+    FifoDrainResult result;
+    memset(&result, 0, sizeof(result));
+    
+    if (fifo.sampleSize == 0 || ring.capacity == 0) {
+        result.status = 4;
+        return result;
+    }
+    
+    uint32_t startTime = micros();
+    
+    // Read the FIFO fill level
+    beginTransmission(fifo.address);
+    write(fifo.countRegister);
+    result.status = endTransmission(false);
+    if (result.status != 0) return result;
+    
+    if (requestFrom(fifo.address, (uint8_t)2) != 2) {
+        result.status = 4;
+        return result;
+    }
+    uint8_t first = read();
+    uint8_t second = read();
+    uint16_t count = fifo.countBigEndian ? ((uint16_t)first << 8) | second : ((uint16_t)second << 8) | first;
+    
+    // Only whole samples, and no more than the ring can take
+    uint16_t available = fifo.countInSamples ? count : count / fifo.sampleSize;
+    uint16_t wanted = min(available, min((uint16_t)(ring.capacity - ring.count), maxSamples));
+    result.remaining = available;
+    
+    // Largest chunk that fits both the Wire buffer and a uint8_t requestFrom(),
+    // rounded to whole samples; samples bigger than a chunk are read in pieces
+    uint16_t chunkLimit = min((uint16_t)SAI2C_WIRE_BUFFER_SIZE, (uint16_t)255);
+    if (chunkLimit >= fifo.sampleSize) {
+        chunkLimit = (chunkLimit / fifo.sampleSize) * fifo.sampleSize;
+    }
+    
+    uint32_t bytesLeft = (uint32_t)wanted * fifo.sampleSize;
+    uint8_t sampleOffset = 0;
+    
+    while (bytesLeft > 0) {
+        uint8_t chunk = (bytesLeft > chunkLimit) ? (uint8_t)chunkLimit : (uint8_t)bytesLeft;
+        
+        // Repeated start between the register pointer and the burst read
+        beginTransmission(fifo.address);
+        write(fifo.dataRegister);
+        result.status = endTransmission(false);
+        if (result.status != 0) break;
+        
+        uint8_t received = requestFrom(fifo.address, chunk);
+        if (received != chunk) {
+            result.status = 4;
+            break;
+        }
+        
+        for (uint8_t i = 0; i < received; i++) {
+            ring.data[(uint32_t)ring.head * fifo.sampleSize + sampleOffset] = read();
+            if (++sampleOffset == fifo.sampleSize) {
+                sampleOffset = 0;
+                ring.head = (ring.head + 1) % ring.capacity;
+                ring.count++;
+                result.samples++;
+            }
+        }
+        
+        result.bytes += received;
+        bytesLeft -= received;
+    }
+    
+    result.remaining -= result.samples;
+    result.elapsedMicros = micros() - startTime;
+    
+    if (result.samples > 0 && result.elapsedMicros > 0) {
+        result.samplesPerSecond = ((uint32_t)result.samples * 1000000UL) / result.elapsedMicros;
+        
+        // Smooth across drains (1/4 weight on the newest) so bursts don't dominate
+        fifoSampleRate = (fifoSampleRate == 0) ? result.samplesPerSecond
+                                              : (fifoSampleRate * 3 + result.samplesPerSecond) / 4;
+    }
+    
+    // A drain that emptied the FIFO took everything that arrived since the previous one:
+    // that arrival rate sets the slowest clock learning may fall back to
+    uint32_t sinceLastDrain = startTime - lastFifoDrainMicros;
+    if (lastFifoDrainMicros != 0 && result.status == 0 && result.remaining == 0 &&
+        result.samples > 0 && sinceLastDrain > 0) {
+        uint32_t arrivalRate = ((uint32_t)result.samples * 1000000UL) / sinceLastDrain;
+        uint32_t needed = arrivalRate * fifo.sampleSize * FIFO_BITS_PER_BYTE * FIFO_CLOCK_MARGIN;
+        fifoMinClock = (fifoMinClock == 0) ? needed : (fifoMinClock * 3 + needed) / 4;
+    }
+    lastFifoDrainMicros = startTime;
+    
+    return result;
+}
+
+uint32_t SelfAdjustingI2C::getFifoSampleRate() const {
+    return fifoSampleRate;
+}
+
+uint32_t SelfAdjustingI2C::getFifoMinClock() const {
+    return fifoMinClock;
+}
+
+ArrayReadResult SelfAdjustingI2C::readArray(const uint8_t* addresses, uint8_t count, uint8_t reg, uint8_t length,
+                                            uint8_t* buffer, uint8_t* status) {
+    ArrayReadResult result;
+    memset(&result, 0, sizeof(result));
+    
+    if (length == 0 || (uint16_t)length > SAI2C_WIRE_BUFFER_SIZE) {
+        result.failed = count;
+        return result;
+    }
+    
+    uint32_t startTime = micros();
+    uint32_t transactionTimes[ARRAY_READ_BATCH_SIZE];
+    uint8_t errors[ARRAY_READ_BATCH_SIZE];
+    bool shortGaps[ARRAY_READ_BATCH_SIZE];
+    bool shortReads[ARRAY_READ_BATCH_SIZE]; // Status 4 from a short requestFrom(), not endTransmission()
+    
+    for (uint8_t batchStart = 0; batchStart < count; batchStart += ARRAY_READ_BATCH_SIZE) {
+        uint8_t batchSize = min((uint8_t)(count - batchStart), (uint8_t)ARRAY_READ_BATCH_SIZE);
+        
+        // Bus phase: register pointer, repeated start and read for each device back to back.
+        // Metrics, profiling and learning are deferred so nothing runs between transactions.
+        for (uint8_t i = 0; i < batchSize; i++) {
+            uint8_t address = addresses[batchStart + i];
+            uint8_t* out = buffer + (uint16_t)(batchStart + i) * length;
+            
+            startTransaction(address);
+            shortGaps[i] = shortGapStart;
+            shortReads[i] = false;
+            
+            uint32_t startTicks = readTimingTicks();
+            uint8_t error = injectFault(address);
+            if (error == 0) {
+                wire->beginTransmission(address);
+                wire->write(reg);
+                error = wire->endTransmission(false);
+            }
+            
+            if (error == 0) {
+                if (wire->requestFrom(address, length) == length) {
+                    for (uint8_t b = 0; b < length; b++) {
+                        out[b] = wire->read();
+                    }
+                } else {
+                    while (wire->available()) wire->read();
+                    error = 4;
+                    shortReads[i] = true;
+                }
+            }
+            
+            transactionTimes[i] = elapsedMicros(startTicks);
+            errors[i] = error;
+            if (gapTuning) lastStopMicros = micros();
+        }
+        
+        // Bookkeeping phase: feed the whole batch to the optimizer in one pass
+        for (uint8_t i = 0; i < batchSize; i++) {
+            uint8_t address = addresses[batchStart + i];
+            bool success = (errors[i] == 0);
+            
+            if (status != nullptr) status[batchStart + i] = errors[i];
+            result.busMicros += transactionTimes[i];
+            if (success) result.succeeded++; else result.failed++;
+            
+            if (profilerEnabled) {
+                profileTransaction(address, reg, success ? length : 0, transactionTimes[i]);
+            }
+            
+            currentDeviceAddress = address;
+            shortGapStart = shortGaps[i];
+            finishTransaction(success, transactionTimes[i], address,
+                              shortReads[i] ? ERROR_TIMEOUT : classifyError(errors[i]));
+        }
+    }
+    
+    result.elapsedMicros = micros() - startTime;
+    if (result.succeeded > 0 && result.elapsedMicros > 0) {
+        result.readsPerSecond = ((uint32_t)result.succeeded * 1000000UL) / result.elapsedMicros;
+    }
+    
+    return result;
+}
+
+bool SelfAdjustingI2C::pollForAck(uint8_t address, uint16_t timeoutMs, uint32_t& waitedMicros) {
+    // The device NACKs its address until the internal write cycle finishes
+    uint32_t startTime = micros();
+    uint32_t timeoutMicros = (uint32_t)timeoutMs * 1000UL;
+    
+    do {
+        if (probeDevice(address)) {
+            waitedMicros = micros() - startTime;
+            return true;
+        }
+        yield(); // Long write timeouts must not starve the watchdog
+    } while (micros() - startTime < timeoutMicros);
+    
+    waitedMicros = micros() - startTime;
+    return false;
+}
+
+EepromWriteResult SelfAdjustingI2C::writeEeprom(uint8_t address, uint16_t memoryAddress, const uint8_t* data, uint16_t length,
+                                                uint8_t pageSize, uint8_t addressBytes, uint16_t writeTimeoutMs) {
+    EepromWriteResult result;
+    memset(&result, 0, sizeof(result));
+    
+    if (pageSize == 0 || addressBytes == 0 || addressBytes > 2) {
+        result.status = 4;
+        return result;
+    }
+    
+    // A page write must also fit the Wire buffer together with the address bytes
+    uint8_t maxChunk = min(pageSize, (uint8_t)(SAI2C_WIRE_BUFFER_SIZE - addressBytes));
+    uint32_t startTime = micros();
+    
+    while (result.bytesWritten < length) {
+        uint16_t position = memoryAddress + result.bytesWritten;
+        
+        // Never cross a page boundary - the device would wrap within the page
+        uint8_t chunk = pageSize - (position % pageSize);
+        chunk = min(chunk, maxChunk);
+        if (chunk > length - result.bytesWritten) {
+            chunk = length - result.bytesWritten;
+        }
+        
+        // Single-address-byte parts (24C04-24C16) take A8-A10 in the device address
+        uint8_t deviceAddress = address;
+        if (addressBytes == 1) {
+            deviceAddress = address | ((position >> 8) & 0x07);
+        }
+        
+        beginTransmission(deviceAddress);
+        if (addressBytes == 2) {
+            write((uint8_t)(position >> 8));
+        }
+        write((uint8_t)(position & 0xFF));
+        write(data + result.bytesWritten, chunk);
+        result.status = endTransmission();
+        if (result.status != 0) break;
+        
+        result.pages++;
+        result.bytesWritten += chunk;
+        
+        uint32_t waited = 0;
+        bool ready = pollForAck(deviceAddress, writeTimeoutMs, waited);
+        if (waited > result.maxWriteCycleMicros) {
+            result.maxWriteCycleMicros = waited;
+        }
+        if (!ready) {
+            result.status = 5;
+            break;
+        }
+    }
+    
+    result.elapsedMicros = micros() - startTime;
+    if (result.elapsedMicros > 0) {
+        result.bytesPerSecond = ((uint32_t)result.bytesWritten * 1000000UL) / result.elapsedMicros;
+    }
+    
+    return result;
+}
+
+uint16_t SelfAdjustingI2C::fletcher16(const uint8_t* data, size_t length) {
+    uint16_t sum1 = 0;
+    uint16_t sum2 = 0;
+    for (size_t i = 0; i < length; i++) {
+        sum1 = (sum1 + data[i]) % 255;
+        sum2 = (sum2 + sum1) % 255;
+    }
+    return (sum2 << 8) | sum1;
+}
+
+size_t SelfAdjustingI2C::getConfigurationExportSize() const {
+    return CONFIG_BLOB_HEADER_BYTES + (size_t)deviceCount * CONFIG_BLOB_DEVICE_BYTES + CONFIG_BLOB_SCORE_BYTES + 2;
+}
+
+size_t SelfAdjustingI2C::exportConfiguration(uint8_t* buffer, size_t bufferSize) const {
+    size_t length = getConfigurationExportSize();
+    if (bufferSize < length) return 0;
+    
+    // Header: ranges are included so steps are only reused on identically configured units
+    uint8_t* out = buffer;
+    *out++ = 'F';
+    *out++ = 'C';
+    *out++ = CONFIG_BLOB_FORMAT_VERSION;
+    *out++ = DYNAMIC_RANGE_STEPS;
+    for (uint8_t i = 0; i < 4; i++) *out++ = (clockSpeedRange.min_value >> (8 * i)) & 0xFF;
+    for (uint8_t i = 0; i < 4; i++) *out++ = (clockSpeedRange.max_value >> (8 * i)) & 0xFF;
+    *out++ = riseTimeRange.min_value & 0xFF;
+    *out++ = (riseTimeRange.min_value >> 8) & 0xFF;
+    *out++ = riseTimeRange.max_value & 0xFF;
+    *out++ = (riseTimeRange.max_value >> 8) & 0xFF;
+    *out++ = bestConfig.clockSpeedStep;
+    *out++ = bestConfig.riseTimeStep;
+    *out++ = deviceCount;
+    
+    // Learned per-device configurations
+    for (uint8_t i = 0; i < deviceCount; i++) {
+        *out++ = deviceConfigs[i].address;
+        *out++ = deviceConfigs[i].config.clockSpeedStep;
+        *out++ = deviceConfigs[i].config.riseTimeStep;
+        *out++ = deviceConfigs[i].hasCustomConfig ? 0x01 : 0x00;
+    }
+    
+    // Step score table, already packed
+    memcpy(out, stepScoreTable, CONFIG_BLOB_SCORE_BYTES);
+    out += CONFIG_BLOB_SCORE_BYTES;
+    
+    uint16_t checksum = fletcher16(buffer, out - buffer);
+    *out++ = checksum & 0xFF;
+    *out++ = checksum >> 8;
+    
+    return length;
+}
+
+bool SelfAdjustingI2C::importConfiguration(const uint8_t* blob, size_t length, bool validateOnBus) {
+    // Validate framing before touching any state
+    if (length < CONFIG_BLOB_HEADER_BYTES + CONFIG_BLOB_SCORE_BYTES + 2) return false;
+    if (blob[0] != 'F' || blob[1] != 'C' || blob[2] != CONFIG_BLOB_FORMAT_VERSION) return false;
+    if (blob[3] != DYNAMIC_RANGE_STEPS) return false;
+    
+    uint8_t blobDevices = blob[CONFIG_BLOB_HEADER_BYTES - 1];
+    size_t expected = CONFIG_BLOB_HEADER_BYTES + (size_t)blobDevices * CONFIG_BLOB_DEVICE_BYTES + CONFIG_BLOB_SCORE_BYTES + 2;
+    if (length != expected || blobDevices > MAX_DEVICES) return false;
+    
+    uint16_t checksum = blob[length - 2] | ((uint16_t)blob[length - 1] << 8);
+    if (fletcher16(blob, length - 2) != checksum) return false;
+    
+    // Steps are only meaningful if the ranges match this unit's
+    uint32_t clockMin = 0, clockMax = 0;
+    for (uint8_t i = 0; i < 4; i++) {
+        clockMin |= (uint32_t)blob[4 + i] << (8 * i);
+        clockMax |= (uint32_t)blob[8 + i] << (8 * i);
+    }
+    uint16_t riseMin = blob[12] | ((uint16_t)blob[13] << 8);
+    uint16_t riseMax = blob[14] | ((uint16_t)blob[15] << 8);
+    if (clockMin != clockSpeedRange.min_value || clockMax != clockSpeedRange.max_value ||
+        riseMin != riseTimeRange.min_value || riseMax != riseTimeRange.max_value) {
+        return false;
+    }
+    
+    uint8_t bestClockStep = blob[CONFIG_BLOB_HEADER_BYTES - 3];
+    uint8_t bestRiseStep = blob[CONFIG_BLOB_HEADER_BYTES - 2];
+    if (!isStepValid(bestClockStep) || !isStepValid(bestRiseStep)) return false;
+    
+    // Pick the devices this unit actually has; nothing is changed until the blob is accepted
+    const uint8_t* devices = blob + CONFIG_BLOB_HEADER_BYTES;
+    bool accepted[MAX_DEVICES];
+    uint8_t acceptedCount = 0;
+    for (uint8_t i = 0; i < blobDevices; i++) {
+        accepted[i] = false;
+        const uint8_t* device = devices + i * CONFIG_BLOB_DEVICE_BYTES;
+        if (!isStepValid(device[1]) || !isStepValid(device[2])) continue;
+        
+        if (validateOnBus) {
+            wire->beginTransmission(device[0]);
+            if (wire->endTransmission() != 0) continue;
+        }
+        accepted[i] = true;
+        acceptedCount++;
+    }
+    
+    // A blob that matches none of this unit's devices says nothing about its bus
+    if (acceptedCount == 0) return false;
+    
+    // Start at the fleet optimum, but only if it works with this unit's devices
+    if (validateOnBus) {
+        I2CConfig servingConfig = currentConfig;
+        probingConfiguration = true;
+        currentConfig.clockSpeed = calculateValueFromStep(clockSpeedRange, bestClockStep);
+        currentConfig.riseTime = calculateValueFromStep(riseTimeRange, bestRiseStep);
+        applyConfiguration();
+        
+        bool bestWorks = true;
+        for (uint8_t i = 0; i < blobDevices && bestWorks; i++) {
+            if (!accepted[i]) continue;
+            wire->beginTransmission(devices[i * CONFIG_BLOB_DEVICE_BYTES]);
+            bestWorks = (wire->endTransmission() == 0);
+        }
+        
+        currentConfig = servingConfig;
+        applyConfiguration();
+        probingConfiguration = false;
+        
+        if (!bestWorks) return false;
+    }
+    
+    // Accepted: seed device configs and step scores
+    for (uint8_t i = 0; i < blobDevices; i++) {
+        if (!accepted[i]) continue;
+        const uint8_t* device = devices + i * CONFIG_BLOB_DEVICE_BYTES;
+        
+        DeviceConfig* deviceConfig = findDeviceConfig(device[0]);
+        if (deviceConfig == nullptr) {
+            addDeviceConfig(device[0]);
+            deviceConfig = findDeviceConfig(device[0]);
+        }
+        if (deviceConfig == nullptr) continue;
+        
+        if (device[3] & 0x01) {
+            deviceConfig->config.clockSpeedStep = device[1];
+            deviceConfig->config.riseTimeStep = device[2];
+            deviceConfig->config.clockSpeed = calculateValueFromStep(clockSpeedRange, device[1]);
+            deviceConfig->config.riseTime = calculateValueFromStep(riseTimeRange, device[2]);
+            deviceConfig->hasCustomConfig = true;
+        }
+        if (validateOnBus && !deviceConfig->isPresent) {
+            setDevicePresent(deviceConfig, true);
+        }
+    }
+    
+    memcpy(stepScoreTable, devices + blobDevices * CONFIG_BLOB_DEVICE_BYTES, CONFIG_BLOB_SCORE_BYTES);
+    lastStepScoreDecay = millis();
+    
+    currentConfig.clockSpeedStep = bestClockStep;
+    currentConfig.riseTimeStep = bestRiseStep;
+    updateDynamicRange(clockSpeedRange, bestClockStep);
+    updateDynamicRange(riseTimeRange, bestRiseStep);
+    currentConfig.clockSpeed = clockSpeedRange.current_value;
+    currentConfig.riseTime = riseTimeRange.current_value;
+    memset(&currentConfig.metrics, 0, sizeof(I2CPerformanceMetrics));
+    resetLatencyWindow();
+    currentConfig.metrics.lastUpdateTime = millis();
+    applyConfiguration();
+    saveCurrentAsBest();
+    
+    return true;
+}
+
+#if SAI2C_ENABLE_DECISION_LOG
+
+void SelfAdjustingI2C::logDecision(DecisionReason reason, uint8_t confidence, uint8_t oldClockStep, uint8_t oldRiseStep,
+                                   float currentScore, float bestScore, float trend, float recentErrorRate) {
+    DecisionLogEntry& entry = decisionLog[decisionLogIndex];
+    
+    entry.timestamp = millis();
+    entry.oldClockStep = oldClockStep;
+    entry.oldRiseStep = oldRiseStep;
+    entry.newClockStep = currentConfig.clockSpeedStep;
+    entry.newRiseStep = currentConfig.riseTimeStep;
+    entry.reason = (uint8_t)reason;
+    entry.confidence = confidence;
+    entry.currentScore = (uint8_t)constrain(currentScore, 0.0, 100.0);
+    entry.bestScore = (uint8_t)constrain(bestScore, 0.0, 100.0);
+    entry.recentErrorRate = (uint8_t)constrain(recentErrorRate, 0.0, 100.0);
+    entry.trend = (int8_t)constrain(trend * 10.0, -127.0, 127.0);
+    
+    decisionLogIndex = (decisionLogIndex + 1) % DECISION_LOG_SIZE;
+    if (decisionLogCount < DECISION_LOG_SIZE) {
+        decisionLogCount++;
+    }
+}
+
+uint8_t SelfAdjustingI2C::getDecisionLog(DecisionLogEntry* entries, uint8_t maxEntries) const {
+    // Return the most recent entries, oldest first
+    uint8_t count = min(decisionLogCount, maxEntries);
+    uint8_t start = (decisionLogIndex + DECISION_LOG_SIZE - count) % DECISION_LOG_SIZE;
+    
+    for (uint8_t i = 0; i < count; i++) {
+        entries[i] = decisionLog[(start + i) % DECISION_LOG_SIZE];
+    }
+    return count;
+}
+
+size_t SelfAdjustingI2C::exportDecisionLog(uint8_t* buffer, size_t bufferSize) const {
+    // Header: 'D' 'L' version count, then fixed-size little-endian entries, oldest first
+    if (bufferSize < 4) return 0;
+    
+    uint8_t count = min((size_t)decisionLogCount, (bufferSize - 4) / DECISION_LOG_ENTRY_BYTES);
+    uint8_t start = (decisionLogIndex + DECISION_LOG_SIZE - count) % DECISION_LOG_SIZE;
+    
+    buffer[0] = 'D';
+    buffer[1] = 'L';
+    buffer[2] = DECISION_LOG_FORMAT_VERSION;
+    buffer[3] = count;
+    
+    uint8_t* out = buffer + 4;
+    for (uint8_t i = 0; i < count; i++) {
+        const DecisionLogEntry& entry = decisionLog[(start + i) % DECISION_LOG_SIZE];
+        out[0] = entry.timestamp & 0xFF;
+        out[1] = (entry.timestamp >> 8) & 0xFF;
+        out[2] = (entry.timestamp >> 16) & 0xFF;
+        out[3] = (entry.timestamp >> 24) & 0xFF;
+        out[4] = entry.oldClockStep;
+        out[5] = entry.oldRiseStep;
+        out[6] = entry.newClockStep;
+        out[7] = entry.newRiseStep;
+        out[8] = entry.reason;
+        out[9] = entry.confidence;
+        out[10] = entry.currentScore;
+        out[11] = entry.bestScore;
+        out[12] = entry.recentErrorRate;
+        out[13] = (uint8_t)entry.trend;
+        out += DECISION_LOG_ENTRY_BYTES;
+    }
+    
+    return 4 + (size_t)count * DECISION_LOG_ENTRY_BYTES;
+}
+
+#else
+
+void SelfAdjustingI2C::logDecision(DecisionReason, uint8_t, uint8_t, uint8_t, float, float, float, float) {
+    // Decision log not compiled in (SAI2C_ENABLE_DECISION_LOG)
+}
+
+uint8_t SelfAdjustingI2C::getDecisionLog(DecisionLogEntry*, uint8_t) const {
+    return 0;
+}
+
+size_t SelfAdjustingI2C::exportDecisionLog(uint8_t* buffer, size_t bufferSize) const {
+    // An empty log, so readers of the format need no special case
+    if (bufferSize < 4) return 0;
+    buffer[0] = 'D';
+    buffer[1] = 'L';
+    buffer[2] = DECISION_LOG_FORMAT_VERSION;
+    buffer[3] = 0;
+    return 4;
+}
+
+#endif // SAI2C_ENABLE_DECISION_LOG
+
+void SelfAdjustingI2C::clearDecisionLog() {
+    decisionLogIndex = 0;
+    decisionLogCount = 0;
+}
+
+const char* SelfAdjustingI2C::getDecisionReasonString(DecisionReason reason) {
+    switch (reason) {
+        case REASON_NONE: return "No adjustment needed";
+        case REASON_COOLDOWN: return "Cooldown period active";
+        case REASON_HIGH_ERROR_RATE: return "High error rate detected";
+        case REASON_NEW_BEST: return "New best configuration found";
+        case REASON_POSITIVE_TREND: return "Positive trend, optimizing speed";
+        case REASON_MODERATE_OPTIMIZATION: return "Moderate optimization";
+        case REASON_RESTORE_BEST: return "Restoring best configuration";
+        case REASON_CONSECUTIVE_ERRORS: return "Consecutive errors, reducing speed";
+        case REASON_EMERGENCY_RECOVERY: return "Emergency recovery";
+        case REASON_ADAPTIVE_RECOVERY: return "Adaptive recovery";
+        case REASON_INCREMENTAL_RECOVERY: return "Incremental recovery";
+        case REASON_BACKGROUND_SWEEP: return "Background sweep result";
+        case REASON_TRANSACTION_GAP: return "Device gap widened";
+        case REASON_PADS_STRENGTHENED: return "Pads strengthened";
+        default: return "Unknown";
+    }
+}
+
+void SelfAdjustingI2C::printDecisionLog() const {
+    Serial.println("=== Decision Log ===");
+    
+#if SAI2C_ENABLE_DECISION_LOG
+    DecisionLogEntry entries[DECISION_LOG_SIZE];
+    uint8_t count = getDecisionLog(entries, DECISION_LOG_SIZE);
+    
+    for (uint8_t i = 0; i < count; i++) {
+        Serial.print(entries[i].timestamp);
+        Serial.print(" ms: clock ");
+        Serial.print(entries[i].oldClockStep);
+        Serial.print("->");
+        Serial.print(entries[i].newClockStep);
+        Serial.print(", rise ");
+        Serial.print(entries[i].oldRiseStep);
+        Serial.print("->");
+        Serial.print(entries[i].newRiseStep);
+        Serial.print(" | ");
+        Serial.print(getDecisionReasonString((DecisionReason)entries[i].reason));
+        Serial.print(" (confidence ");
+        Serial.print(entries[i].confidence);
+        Serial.print(", score ");
+        Serial.print(entries[i].currentScore);
+        Serial.print("/");
+        Serial.print(entries[i].bestScore);
+        Serial.print(", errors ");
+        Serial.print(entries[i].recentErrorRate);
+        Serial.println("%)");
+    }
+#else
+    Serial.println("Not compiled in (build with SAI2C_ENABLE_DECISION_LOG=1)");
+#endif
+    
+    Serial.println("====================");
+}
+
+void SelfAdjustingI2C::onConfigChange(ConfigChangeCallback callback) {
+    configChangeCallback = callback;
+}
+
+void SelfAdjustingI2C::onError(ErrorCallback callback) {
+    errorCallback = callback;
+}
+
+void SelfAdjustingI2C::onRecovery(RecoveryCallback callback) {
+    recoveryCallback = callback;
+}
+
+void SelfAdjustingI2C::onDeviceChange(DeviceCallback callback) {
+    deviceCallback = callback;
+}
+
+void SelfAdjustingI2C::setFaultInjector(I2CFaultInjector* injector) {
+    faultInjector = injector;
+}
+
+void SelfAdjustingI2C::enableProfiler(bool enable) {
+    // Stays off when the profiler isn't compiled in, so the hot path skips it
+    profilerEnabled = enable && SAI2C_ENABLE_PROFILER;
+}
+
+#if SAI2C_ENABLE_PROFILER
+
+void SelfAdjustingI2C::resetProfiler() {
+    memset(profileTable, 0, sizeof(profileTable));
+    profileLastRegister = PROFILE_NO_REGISTER;
+}
+
+void SelfAdjustingI2C::profileTransaction(uint8_t address, uint16_t reg, uint16_t bytes, uint32_t transactionTime) {
+    AccessProfileEntry* slot = nullptr;
+    AccessProfileEntry* leastUsed = &profileTable[0];
+    
+    for (uint8_t i = 0; i < PROFILER_SLOTS; i++) {
+        AccessProfileEntry& entry = profileTable[i];
+        if (entry.count > 0 && entry.address == address && entry.reg == reg) {
+            slot = &entry;
+            break;
+        }
+        if (entry.count < leastUsed->count) {
+            leastUsed = &entry;
+        }
+    }
+    
+    if (slot == nullptr) {
+        // Space-saving replacement: the newcomer inherits the evicted count so
+        // heavy hitters can't be pushed out by a stream of one-off accesses
+        slot = leastUsed;
+        slot->address = address;
+        slot->reg = reg;
+        slot->bytes = 0;
+        slot->totalTime = 0;
+    }
+    
+    slot->count++;
+    slot->bytes += bytes;
+    slot->totalTime += transactionTime;
+}
+
+uint8_t SelfAdjustingI2C::getTopAccessPatterns(AccessProfileEntry* entries, uint8_t maxEntries) const {
+    uint8_t found = 0;
+    
+    // Insertion into the caller's buffer, ordered by bus time
+    for (uint8_t i = 0; i < PROFILER_SLOTS; i++) {
+        const AccessProfileEntry& entry = profileTable[i];
+        if (entry.count == 0) continue;
+        
+        uint8_t pos = found;
+        while (pos > 0 && entries[pos - 1].totalTime < entry.totalTime) {
+            if (pos < maxEntries) entries[pos] = entries[pos - 1];
+            pos--;
+        }
+        if (pos < maxEntries) {
+            entries[pos] = entry;
+            if (found < maxEntries) found++;
+        }
+    }
+    
+    return found;
+}
+
+#else
+
+void SelfAdjustingI2C::resetProfiler() {
+    profileLastRegister = PROFILE_NO_REGISTER;
+}
+
+void SelfAdjustingI2C::profileTransaction(uint8_t, uint16_t, uint16_t, uint32_t) {
+    // Profiler not compiled in (SAI2C_ENABLE_PROFILER)
+}
+
+uint8_t SelfAdjustingI2C::getTopAccessPatterns(AccessProfileEntry*, uint8_t) const {
+    return 0;
+}
+
+#endif // SAI2C_ENABLE_PROFILER
+
+void SelfAdjustingI2C::printProfile(uint8_t topN) const {
+    Serial.println("=== I2C Access Profile ===");
+    
+#if SAI2C_ENABLE_PROFILER
+    AccessProfileEntry top[PROFILER_SLOTS];
+    uint8_t count = getTopAccessPatterns(top, min(topN, (uint8_t)PROFILER_SLOTS));
+    
+    for (uint8_t i = 0; i < count; i++) {
+        Serial.print("0x");
+        if (top[i].address < 16) Serial.print("0");
+        Serial.print(top[i].address, HEX);
+        Serial.print(" reg ");
+        if (top[i].reg == PROFILE_NO_REGISTER) {
+            Serial.print("--");
+        } else {
+            Serial.print("0x");
+            if (top[i].reg < 16) Serial.print("0");
+            Serial.print(top[i].reg, HEX);
+        }
+        Serial.print(" | Count: ");
+        Serial.print(top[i].count);
+        Serial.print(", Bytes: ");
+        Serial.print(top[i].bytes);
+        Serial.print(", Time: ");
+        Serial.print(top[i].totalTime);
+        Serial.println(" μs");
+    }
+#else
+    (void)topN;
+    Serial.println("Not compiled in (build with SAI2C_ENABLE_PROFILER=1)");
+#endif
+    
+    Serial.println("==========================");
+}
+
+// Bus group implementation
+
+SelfAdjustingI2CGroup::SelfAdjustingI2CGroup() {
+    memset(buses, 0, sizeof(buses));
+    memset((void*)inFlight, 0, sizeof(inFlight));
+    memset(routedTransactions, 0, sizeof(routedTransactions));
+    busCount = 0;
+#if SAI2C_GROUP_LOCKING
+    portMUX_INITIALIZE(&routeMux);
+    memset(busLocks, 0, sizeof(busLocks));
+#endif
+}
+
+bool SelfAdjustingI2CGroup::addBus(SelfAdjustingI2C& bus) {
+    if (busCount >= MAX_BUS_GROUP_SIZE) {
+        return false;
+    }
+#if SAI2C_GROUP_LOCKING
+    busLocks[busCount] = xSemaphoreCreateMutex();
+    if (busLocks[busCount] == nullptr) return false;
+#endif
+    buses[busCount++] = &bus;
+    return true;
+}
+
+uint8_t SelfAdjustingI2CGroup::getBusCount() const {
+    return busCount;
+}
+
+int8_t SelfAdjustingI2CGroup::acquireBus(uint8_t address) {
+    int8_t bestBus = -1;
+    uint32_t bestCost = 0xFFFFFFFF;
+    
+    // Choosing and counting must be one step, or two tasks can pick on the same stale counts
+#if SAI2C_GROUP_LOCKING
+    portENTER_CRITICAL(&routeMux);
+#endif
+    for (uint8_t i = 0; i < busCount; i++) {
+        if (!buses[i]->isDevicePresent(address)) continue;
+        
+        // Expected wait: everything queued on this bus plus our own transaction
+        uint32_t latency = buses[i]->getRobustTransactionTime();
+        if (latency == 0) latency = 1; // Untimed bus - balance on queue depth alone
+        uint32_t cost = (uint32_t)(inFlight[i] + 1) * latency;
+        
+        if (cost < bestCost) {
+            bestCost = cost;
+            bestBus = i;
+        }
+    }
+    
+    if (bestBus >= 0) {
+        inFlight[bestBus]++;
+        routedTransactions[bestBus]++;
+    }
+#if SAI2C_GROUP_LOCKING
+    portEXIT_CRITICAL(&routeMux);
+    
+    // One task per bus: SelfAdjustingI2C keeps per-transaction state that must not interleave
+    if (bestBus >= 0) {
+        xSemaphoreTake(busLocks[bestBus], portMAX_DELAY);
+    }
+#endif
+    return bestBus;
+}
+
+void SelfAdjustingI2CGroup::releaseBus(int8_t busIndex) {
+    if (busIndex < 0 || busIndex >= busCount) return;
+    
+#if SAI2C_GROUP_LOCKING
+    xSemaphoreGive(busLocks[busIndex]);
+    portENTER_CRITICAL(&routeMux);
+#endif
+    if (inFlight[busIndex] > 0) {
+        inFlight[busIndex]--;
+    }
+#if SAI2C_GROUP_LOCKING
+    portEXIT_CRITICAL(&routeMux);
+#endif
+}
+
+SelfAdjustingI2C* SelfAdjustingI2CGroup::getBus(int8_t busIndex) const {
+    if (busIndex < 0 || busIndex >= busCount) return nullptr;
+    return buses[busIndex];
+}
+
+int8_t SelfAdjustingI2CGroup::readRegisters(uint8_t address, uint8_t reg, uint8_t* buffer, uint8_t length) {
+    int8_t busIndex = acquireBus(address);
+    if (busIndex < 0) return -1;
+    
+    SelfAdjustingI2C* bus = buses[busIndex];
+    bool ok = false;
+    
+    bus->beginTransmission(address);
+    bus->write(reg);
+    if (bus->endTransmission(false) == 0 && bus->requestFrom(address, length) == length) {
+        for (uint8_t i = 0; i < length; i++) {
+            buffer[i] = bus->read();
+        }
+        ok = true;
+    }
+    
+    releaseBus(busIndex);
+    return ok ? busIndex : -1;
+}
+
+uint8_t SelfAdjustingI2CGroup::getQueueDepth(uint8_t busIndex) const {
+    return (busIndex < busCount) ? inFlight[busIndex] : 0;
+}
+
+uint32_t SelfAdjustingI2CGroup::getRoutedTransactions(uint8_t busIndex) const {
+    return (busIndex < busCount) ? routedTransactions[busIndex] : 0;
+}
+
+// Fault injector implementation
+
+I2CFaultInjector::I2CFaultInjector() {
+    memset(steps, 0, sizeof(steps));
+    stepCount = 0;
+    startMillis = 0;
+    running = false;
+    memset(burstRemaining, 0, sizeof(burstRemaining));
+    memset(windowRecovered, 0, sizeof(windowRecovered));
+    successRun = 0;
+    firstFaultMillis = 0;
+    preFaultSuccesses = 0;
+    lastInjected = false;
+    simulatedAddress = 0;
+    memset(&report, 0, sizeof(report));
+}
+
+bool I2CFaultInjector::begin(const FaultStep* script, uint8_t count) {
+    if (count == 0 || count > MAX_FAULT_STEPS) {
+        return false;
+    }
+    
+    memcpy(steps, script, count * sizeof(FaultStep));
+    stepCount = count;
+    memset(&report, 0, sizeof(report));
+    successRun = 0;
+    preFaultSuccesses = 0;
+    lastInjected = false;
+    
+    firstFaultMillis = 0xFFFFFFFF;
+    for (uint8_t i = 0; i < stepCount; i++) {
+        burstRemaining[i] = (steps[i].type == FAULT_BURST_ERRORS) ? steps[i].param : 0;
+        windowRecovered[i] = false;
+        if (steps[i].startMs < firstFaultMillis) firstFaultMillis = steps[i].startMs;
+    }
+    
+    startMillis = millis();
+    running = true;
+    return true;
+}
+
+void I2CFaultInjector::stop() {
+    running = false;
+}
+
+bool I2CFaultInjector::isRunning() const {
+    return running;
+}
+
+bool I2CFaultInjector::isFinished() const {
+    uint32_t elapsed = millis() - startMillis;
+    for (uint8_t i = 0; i < stepCount; i++) {
+        if (elapsed < steps[i].startMs + steps[i].durationMs) return false;
+    }
+    return true;
+}
+
+bool I2CFaultInjector::isWindowActive(uint8_t step, uint32_t elapsed) const {
+    return elapsed >= steps[step].startMs && elapsed < steps[step].startMs + steps[step].durationMs;
+}
+
+uint8_t I2CFaultInjector::inject(uint8_t address, uint32_t clockSpeed, uint32_t timeoutMicros) {
+    lastInjected = false;
+    if (!running) {
+        return 0;
+    }
+    
+    uint32_t elapsed = millis() - startMillis;
+    uint8_t error = 0;
+    
+    for (uint8_t i = 0; i < stepCount && error == 0; i++) {
+        const FaultStep& step = steps[i];
+        if (!isWindowActive(i, elapsed) || (step.address != 0 && step.address != address)) {
+            continue;
+        }
+        
+        switch (step.type) {
+            case FAULT_STUCK_SDA:
+                error = 4;
+                break;
+            case FAULT_BURST_ERRORS:
+                if (burstRemaining[i] > 0) {
+                    burstRemaining[i]--;
+                    error = 4;
+                }
+                break;
+            case FAULT_INTERMITTENT_NACK:
+                if ((uint32_t)random(100) < step.param) error = 2;
+                break;
+            case FAULT_CLOCK_STRETCH: {
+                // A stretch longer than the bus timeout is cut off by it
+                uint32_t stretch = min(step.param, timeoutMicros);
+                delay(stretch / 1000);
+                delayMicroseconds(stretch % 1000);
+                if (step.param >= timeoutMicros) error = 5;
+                break;
+            }
+            case FAULT_SPEED_BIT_ERRORS:
+                if (step.param > 0 && clockSpeed > step.param) {
+                    // 10% just above the limit, rising with the overshoot
+                    uint32_t percent = 10 + (clockSpeed - step.param) * 100 / step.param;
+                    if ((uint32_t)random(100) < percent) error = 3;
+                }
+                break;
+            default:
+                break;
+        }
+    }
+    
+    if (error != 0) {
+        lastInjected = true;
+        report.injectedFaults++;
+    } else if (simulates(address) && clockSpeed > 0) {
+        delayMicroseconds(FAULT_SIMULATED_FRAME_BITS * 1000000UL / clockSpeed);
+    }
+    return error;
+}
+
+void I2CFaultInjector::simulateDevice(uint8_t address) {
+    simulatedAddress = address;
+}
+
+bool I2CFaultInjector::simulates(uint8_t address) const {
+    return simulatedAddress != 0 && address == simulatedAddress;
+}
+
+void I2CFaultInjector::recordOutcome(bool success) {
+    if (!running) {
+        return;
+    }
+    
+    uint32_t elapsed = millis() - startMillis;
+    report.transactions++;
+    
+    if (success) {
+        report.successes++;
+        if (elapsed < firstFaultMillis) preFaultSuccesses++;
+        if (successRun < 255) successRun++;
+    } else {
+        successRun = 0;
+        if (!lastInjected) report.collateralFailures++;
+    }
+    lastInjected = false;
+    
+    // A window has recovered once a run of successes follows its end
+    if (successRun < FAULT_RECOVERY_SUCCESS_RUN) {
+        return;
+    }
+    
+    for (uint8_t i = 0; i < stepCount; i++) {
+        uint32_t windowEnd = steps[i].startMs + steps[i].durationMs;
+        if (!windowRecovered[i] && elapsed >= windowEnd) {
+            windowRecovered[i] = true;
+            report.worstRecoveryMillis = max(report.worstRecoveryMillis, elapsed - windowEnd);
+        }
+    }
+}
+
+FaultScenarioReport I2CFaultInjector::getReport() const {
+    FaultScenarioReport result = report;
+    uint32_t elapsed = millis() - startMillis;
+    
+    for (uint8_t i = 0; i < stepCount; i++) {
+        if (!windowRecovered[i]) result.unrecoveredWindows++;
+    }
+    
+    // Successes expected at the pre-fault rate versus those achieved
+    if (firstFaultMillis > 0 && firstFaultMillis != 0xFFFFFFFF && preFaultSuccesses > 0 && elapsed > 0) {
+        float expected = (float)preFaultSuccesses * elapsed / firstFaultMillis;
+        if (expected > result.successes) {
+            result.throughputLost = (uint8_t)min(100.0f, (1.0f - result.successes / expected) * 100.0f);
+        }
+    }
+    
+    return result;
+}
+
+void I2CFaultInjector::printReport() const {
+    FaultScenarioReport r = getReport();
+    
+    Serial.println("=== Fault Scenario Report ===");
+    Serial.print("Transactions: ");
+    Serial.print(r.transactions);
+    Serial.print(", successes: ");
+    Serial.println(r.successes);
+    Serial.print("Injected faults: ");
+    Serial.print(r.injectedFaults);
+    Serial.print(", collateral failures: ");
+    Serial.println(r.collateralFailures);
+    Serial.print("Worst recovery: ");
+    Serial.print(r.worstRecoveryMillis);
+    Serial.print(" ms, unrecovered windows: ");
+    Serial.println(r.unrecoveredWindows);
+    Serial.print("Throughput lost: ");
+    Serial.print(r.throughputLost);
+    Serial.println("%");
+    Serial.println("=============================");
+}
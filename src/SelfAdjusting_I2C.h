@@ -10,9 +10,209 @@
 #define ERROR_THRESHOLD 3
 #define PERFORMANCE_SAMPLES 5
 #define DEFAULT_TIMEOUT_MS 100
+#ifndef MAX_DEVICES
+#ifdef __AVR__
+#define MAX_DEVICES 8
+#else
 #define MAX_DEVICES 16
+#endif
+#endif
 #define DYNAMIC_RANGE_STEPS 20  // Number of steps in dynamic ranges
 
+// Step score table configuration (4-bit score per clock/rise step pair)
+#define STEP_SCORE_UNKNOWN 0          // Step pair never evaluated
+#define STEP_SCORE_NEUTRAL 8          // Scores decay back towards this value
+#define STEP_SCORE_BAD_THRESHOLD 4    // At or below: known-bad, skipped until decayed
+#define STEP_SCORE_GOOD_THRESHOLD 11  // At or above: known-good, safe jump target
+#define STEP_SCORE_MAX 15
+#define STEP_SCORE_DECAY_MS 60000     // Move scores one point towards neutral every minute
+
+// Background optimization configuration
+#define BACKGROUND_SCAN_BUDGET_US 2000  // Default time slice per update() call
+
+// update() tick cadence
+#define UPDATE_INTERVAL_MS 100          // Minimum time between learning cycles
+#define HISTORY_INTERVAL_MS 1000        // Performance history rollover period
+#define MARGIN_PROBE_INTERVAL_MS 30000  // Period of headroom probes one step above current
+
+// Transaction timing source
+// Cortex-M3/M4/M7/M33 use the DWT cycle counter and ESP32/ESP8266 the CPU
+// cycle counter. AVR can opt in to Timer1 (0.5us at 16MHz) with
+// enableHardwareTimerTiming(); everything else falls back to micros().
+#if defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__) || defined(__ARM_ARCH_8M_MAIN__)
+#define SAI2C_TIMING_DWT 1
+#define SAI2C_DWT_CTRL   (*(volatile uint32_t*)0xE0001000)
+#define SAI2C_DWT_CYCCNT (*(volatile uint32_t*)0xE0001004)
+#define SAI2C_DWT_LAR    (*(volatile uint32_t*)0xE0001FB0)
+#define SAI2C_DEMCR      (*(volatile uint32_t*)0xE000EDFC)
+#elif defined(ESP32) || defined(ESP8266)
+#define SAI2C_TIMING_CPU_CYCLES 1
+#elif defined(__AVR__) && defined(TCNT1)
+#define SAI2C_TIMING_AVR_TIMER1 1
+#endif
+
+#define TIMING_CALIBRATION_SAMPLES 8
+
+// Optional diagnostics, compiled in on request. Set these as build flags, not in
+// the sketch: the library is compiled separately and the class layout must match
+#ifndef SAI2C_ENABLE_PROFILER
+#define SAI2C_ENABLE_PROFILER 0
+#endif
+#ifndef SAI2C_ENABLE_DECISION_LOG
+#define SAI2C_ENABLE_DECISION_LOG 0
+#endif
+
+// Access-pattern profiler
+#ifndef PROFILER_SLOTS
+#ifdef __AVR__
+#define PROFILER_SLOTS 4
+#else
+#define PROFILER_SLOTS 16
+#endif
+#endif
+#define PROFILE_NO_REGISTER 0xFFFF  // Transaction without a preceding register write
+
+// Decision log
+#ifndef DECISION_LOG_SIZE
+#ifdef __AVR__
+#define DECISION_LOG_SIZE 4
+#else
+#define DECISION_LOG_SIZE 32
+#endif
+#endif
+#define DECISION_LOG_ENTRY_BYTES 14       // Serialized size of one entry in exportDecisionLog()
+#define DECISION_LOG_FORMAT_VERSION 1
+
+// Largest single Wire transfer supported by the core
+#if defined(I2C_BUFFER_LENGTH)
+#define SAI2C_WIRE_BUFFER_SIZE I2C_BUFFER_LENGTH
+#elif defined(BUFFER_LENGTH)
+#define SAI2C_WIRE_BUFFER_SIZE BUFFER_LENGTH
+#else
+#define SAI2C_WIRE_BUFFER_SIZE 32
+#endif
+
+// FIFO drain clock floor: bus bits needed per sample byte (8 data + ACK), and
+// headroom for addressing, register pointers and bookkeeping between drains
+#define FIFO_BITS_PER_BYTE 9
+#define FIFO_CLOCK_MARGIN 2
+
+// Per-device inter-transaction gap (bus-free time before a device's START)
+#define TRANSACTION_GAP_STEP_US 50      // Gap increase per tuning step
+#define TRANSACTION_GAP_MAX_US 1000     // Beyond this, failures go back to the clock optimizer
+#define TRANSACTION_GAP_STRIKES 2       // Short-gap failures before the gap is widened
+
+// Per-device adaptive timeouts: smoothed mean plus deviation of each device's transaction time
+#define TIMEOUT_MIN_US 1000             // Floor, keeps slow interrupts from causing false timeouts
+#define TIMEOUT_DEVIATION_FACTOR 4      // Timeout = mean + factor * deviation
+#define TIMEOUT_MIN_SAMPLES 16          // Successes before a device leaves DEFAULT_TIMEOUT_MS
+
+// Bounded execution of long blocking operations
+#ifdef ESP32
+#define LONG_RUN_YIELD_MS 50            // delay(1) lets the idle task feed the task watchdog
+#else
+#define LONG_RUN_YIELD_MS 10            // yield() feeds the ESP8266 software watchdog
+#endif
+
+// Array read batching (timings are buffered on the stack between bookkeeping passes)
+#ifdef __AVR__
+#define ARRAY_READ_BATCH_SIZE 8
+#else
+#define ARRAY_READ_BATCH_SIZE 16
+#endif
+
+// Fault injection
+#define MAX_FAULT_STEPS 8
+#define FAULT_RECOVERY_SUCCESS_RUN 8    // Consecutive successes that count as recovered
+#define FAULT_SIMULATED_FRAME_BITS 27   // Address + two bytes, each with its ACK bit
+
+// Bus group configuration
+#define MAX_BUS_GROUP_SIZE 4
+
+// Bus groups lock their buses where tasks can drive them concurrently (FreeRTOS on ESP32)
+#ifndef SAI2C_GROUP_LOCKING
+#if defined(ESP32)
+#define SAI2C_GROUP_LOCKING 1
+#else
+#define SAI2C_GROUP_LOCKING 0
+#endif
+#endif
+
+#if SAI2C_GROUP_LOCKING
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#endif
+
+// Fleet configuration blob
+#define CONFIG_BLOB_FORMAT_VERSION 1
+#define CONFIG_BLOB_HEADER_BYTES 19       // Magic, version, step count, ranges, best steps, device count
+#define CONFIG_BLOB_DEVICE_BYTES 4        // Address, clock step, rise step, flags
+#define CONFIG_BLOB_SCORE_BYTES ((DYNAMIC_RANGE_STEPS * DYNAMIC_RANGE_STEPS + 1) / 2)
+#define CONFIG_BLOB_MAX_BYTES (CONFIG_BLOB_HEADER_BYTES + MAX_DEVICES * CONFIG_BLOB_DEVICE_BYTES + CONFIG_BLOB_SCORE_BYTES + 2)
+
+// Analytic bus model: I2C spec rise time (30% to 70% of VDD) is 0.8473 * Rp * Cb
+#define BUS_MODEL_RISE_FACTOR 0.8473f
+
+// Rise-time measurement: a released line reaches the input threshold (~70% VDD)
+// after ~1.20 RC, the spec's 30-70% rise time is 0.8473 RC
+#define RISE_TIME_THRESHOLD_SCALE 0.70f
+#define RISE_TIME_SAMPLES 8
+#define RISE_TIME_TIMEOUT_US 50         // A line still low after this is stuck or unpulled
+
+// Pad tuning levels: 0 = pads as the core's Wire driver set them up, 1 = plus
+// internal pull-ups, higher levels add pad drive strength where the chip allows it
+#if defined(ESP32)
+#define SAI2C_MAX_PAD_LEVEL 2
+#elif defined(ARDUINO_ARCH_RP2040)
+#define SAI2C_MAX_PAD_LEVEL 3
+#else
+#define SAI2C_MAX_PAD_LEVEL 0
+#endif
+
+// Platform capabilities: the clock range the core's Wire driver can realise.
+// The step table never extends outside it (0 = no known lower limit).
+#if defined(__AVR__)
+// Wire.setClock() sets SCL = F_CPU / (16 + 2 * TWBR) with the prescaler at 1
+#ifdef F_CPU
+#define SAI2C_PLATFORM_MIN_CLOCK (F_CPU / (16 + 2 * 255UL))
+#define SAI2C_PLATFORM_MAX_CLOCK (F_CPU / 16)
+#else
+#define SAI2C_PLATFORM_MIN_CLOCK 30418UL
+#define SAI2C_PLATFORM_MAX_CLOCK 1000000UL
+#endif
+#elif defined(ESP8266)
+// Bit-banged; the core clamps to 400kHz at 80MHz CPU and 800kHz at 160MHz
+#define SAI2C_PLATFORM_MIN_CLOCK 1000UL
+#if defined(F_CPU) && F_CPU >= 160000000L
+#define SAI2C_PLATFORM_MAX_CLOCK 800000UL
+#else
+#define SAI2C_PLATFORM_MAX_CLOCK 400000UL
+#endif
+#elif defined(ESP32) || defined(ARDUINO_ARCH_RP2040)
+// Fast-mode Plus is the highest mode the Wire drivers accept
+#define SAI2C_PLATFORM_MIN_CLOCK 0UL
+#define SAI2C_PLATFORM_MAX_CLOCK 1000000UL
+#else
+#define SAI2C_PLATFORM_MIN_CLOCK 0UL
+#define SAI2C_PLATFORM_MAX_CLOCK DEFAULT_CLOCK_RANGE_MAX
+#endif
+
+// No core exposes SDA/SCL slew control through Wire, so rise-time steps are
+// bookkeeping only and sweeps test a single one. A port that implements
+// setHardwareRiseTime() can define this to 1.
+#ifndef SAI2C_HAS_RISE_TIME_CONTROL
+#define SAI2C_HAS_RISE_TIME_CONTROL 0
+#endif
+
+// Robust latency statistics
+#define LATENCY_WINDOW_SIZE 9   // Recent successful transaction times kept for median/trimmed mean
+
+enum TimingSource {
+    TIMING_MICROS = 0,        // micros(), resolution depends on the core (4us on AVR)
+    TIMING_CYCLE_COUNTER = 1, // DWT or ESP CPU cycle counter
+    TIMING_HW_TIMER = 2       // Free-running hardware timer
+};
+
 // Dynamic range configuration for self-adapting I2C parameters
 struct DynamicRange {
     uint32_t min_value;
@@ -24,26 +224,22 @@ struct DynamicRange {
     float step_size;          // Calculated step size for this range
 };
 
-// Self-adapting clock speed range: 75kHz to 3.5MHz
-static DynamicRange clockSpeedRange = {
-    75000,      // min_value: 75kHz safety minimum
-    3500000,    // max_value: 3.5MHz maximum
-    100000,     // current_value: 100kHz starting default
-    100000,     // default_value: 100kHz safe default
-    1,          // current_step: start near minimum for safety
-    1,          // optimal_step: initially same as current
-    0.0         // step_size: calculated dynamically
-};
-
-// Self-adapting rise time range: 40ns to 250ns
-static DynamicRange riseTimeRange = {
-    40,         // min_value: 40ns minimum (aggressive)
-    250,        // max_value: 250ns maximum (conservative)
-    125,        // current_value: 125ns Wire.h default
-    125,        // default_value: 125ns Wire.h default
-    8,          // current_step: middle of range for 125ns default
-    8,          // optimal_step: initially same as current
-    0.0         // step_size: calculated dynamically
+// Default search bounds, narrowed at runtime with setClockRange()/setRiseTimeRange()
+#define DEFAULT_CLOCK_RANGE_MIN 75000     // 75kHz safety minimum
+#define DEFAULT_CLOCK_RANGE_MAX 3500000   // 3.5MHz maximum
+#define DEFAULT_CLOCK_SPEED 100000        // 100kHz safe default
+#define DEFAULT_RISE_RANGE_MIN 40         // 40ns minimum (aggressive)
+#define DEFAULT_RISE_RANGE_MAX 250        // 250ns maximum (conservative)
+#define DEFAULT_RISE_TIME 125             // 125ns Wire.h default
+
+// Achievable clock range and tunable knobs of the current core
+struct PlatformCapabilities {
+    uint32_t minClockSpeed;   // Hz, 0 = no known limit
+    uint32_t maxClockSpeed;   // Hz
+    bool riseTimeControl;     // Rise-time steps reach the hardware
+    bool busTimeout;          // Core has a Wire timeout API
+    bool cycleCounter;        // measureRiseTime() is available
+    uint8_t maxPadLevel;      // 0 = no pad control
 };
 
 // Performance metrics structure
@@ -57,6 +253,70 @@ struct I2CPerformanceMetrics {
     uint32_t lastUpdateTime;
 };
 
+// Constant-memory window of recent transaction times, so a single interrupt
+// or Wi-Fi stall can't skew the latency the optimizer sees
+struct LatencyWindow {
+    uint16_t samples[LATENCY_WINDOW_SIZE];  // Microseconds, saturated at 65535
+    uint8_t index;
+    uint8_t count;
+};
+
+// Bus traffic aggregated per (address, first-written register)
+struct AccessProfileEntry {
+    uint8_t address;
+    uint16_t reg;             // First byte written, or PROFILE_NO_REGISTER
+    uint32_t count;
+    uint32_t bytes;
+    uint32_t totalTime;       // Microseconds on the bus
+};
+
+// Hardware FIFO description for drainFifo()
+struct FifoConfig {
+    uint8_t address;
+    uint8_t countRegister;    // First of two FIFO count registers
+    uint8_t dataRegister;     // FIFO read port
+    uint8_t sampleSize;       // Bytes per sample
+    bool countBigEndian;      // Count high byte first (MPU6050, ICM-20948)
+    bool countInSamples;      // Count register reports samples rather than bytes
+};
+
+// Caller-owned ring buffer of fixed-size samples
+struct SampleRing {
+    uint8_t* data;            // capacity * sampleSize bytes
+    uint16_t capacity;        // In samples
+    uint16_t head;            // Next sample slot to write
+    uint16_t count;           // Samples currently stored
+};
+
+// Outcome of one drainFifo() call
+struct FifoDrainResult {
+    uint16_t samples;         // Samples delivered to the ring
+    uint16_t bytes;
+    uint16_t remaining;       // Whole samples left in the FIFO (ring full or wire error)
+    uint32_t elapsedMicros;
+    uint32_t samplesPerSecond;
+    uint8_t status;           // 0 = success, otherwise Wire error code
+};
+
+// Outcome of one readArray() call
+struct ArrayReadResult {
+    uint8_t succeeded;        // Devices whose read completed
+    uint8_t failed;
+    uint32_t elapsedMicros;   // Whole array, including bookkeeping
+    uint32_t busMicros;       // Sum of the individual transactions
+    uint32_t readsPerSecond;  // Device reads per second over the whole array
+};
+
+// Outcome of one writeEeprom() call
+struct EepromWriteResult {
+    uint16_t bytesWritten;
+    uint16_t pages;              // Page writes issued
+    uint32_t elapsedMicros;
+    uint32_t bytesPerSecond;     // Effective rate including write cycles
+    uint32_t maxWriteCycleMicros; // Longest observed internal write cycle
+    uint8_t status;              // 0 = success, Wire error code, or 5 = write cycle timeout
+};
+
 // Configuration state
 struct I2CConfig {
     uint8_t clockSpeedStep;   // Current step in clock speed range
@@ -72,6 +332,32 @@ struct DeviceConfig {
     uint8_t address;
     I2CConfig config;
     bool hasCustomConfig;
+    bool isPresent;           // Device has answered and not since NACKed its address
+    uint16_t transactionGap;  // Minimum bus-free time before this device's START, us
+    uint8_t gapStrikes;       // Short-gap failures since the gap was last widened
+    bool lastSucceeded;       // Previous transaction to this device succeeded
+    uint16_t latencyMean;     // Smoothed transaction time, us
+    uint16_t latencyDeviation; // Smoothed absolute deviation, us
+    uint8_t latencySamples;   // Saturates at 255
+    uint32_t maxClockSpeed;   // Highest clock the device allows, Hz (0 = no limit)
+};
+
+// Why a configuration change was made
+enum DecisionReason {
+    REASON_NONE = 0,
+    REASON_COOLDOWN = 1,
+    REASON_HIGH_ERROR_RATE = 2,
+    REASON_NEW_BEST = 3,
+    REASON_POSITIVE_TREND = 4,
+    REASON_MODERATE_OPTIMIZATION = 5,
+    REASON_RESTORE_BEST = 6,
+    REASON_CONSECUTIVE_ERRORS = 7,
+    REASON_EMERGENCY_RECOVERY = 8,
+    REASON_ADAPTIVE_RECOVERY = 9,
+    REASON_INCREMENTAL_RECOVERY = 10,
+    REASON_BACKGROUND_SWEEP = 11,
+    REASON_TRANSACTION_GAP = 12,
+    REASON_PADS_STRENGTHENED = 13
 };
 
 // Mini AI decision structure
@@ -81,6 +367,60 @@ struct AIDecision {
     uint8_t confidence;      // 0-100
     bool shouldAdjust;
     const char* reason;      // Reason for decision
+    DecisionReason reasonCode;
+    
+    // Inputs the decision was based on
+    float currentScore;
+    float bestScore;
+    float trend;
+    float recentErrorRate;
+    int8_t stepEvidence;     // +1 current step held up, -1 it failed, 0 nothing learned
+};
+
+// One entry of the decision log ring buffer
+struct DecisionLogEntry {
+    uint32_t timestamp;       // millis() when the decision was applied
+    uint8_t oldClockStep;
+    uint8_t oldRiseStep;
+    uint8_t newClockStep;
+    uint8_t newRiseStep;
+    uint8_t reason;           // DecisionReason
+    uint8_t confidence;       // 0-100
+    uint8_t currentScore;     // 0-100
+    uint8_t bestScore;        // 0-100
+    uint8_t recentErrorRate;  // Percent
+    int8_t trend;             // Score trend x10, clamped to +/-127
+};
+
+// Background optimization phases
+enum BackgroundScanPhase {
+    SCAN_IDLE = 0,
+    SCAN_DISCOVER = 1,   // Probing addresses for devices
+    SCAN_SWEEP = 2,      // Testing clock/rise step combinations
+    SCAN_COMPLETE = 3
+};
+
+// Progress of a time-bounded scanBus() or scanAndOptimize()
+struct BoundedRunResult {
+    bool completed;           // false if the run-time limit stopped it early
+    uint8_t progress;         // 0-100
+    uint8_t devicesFound;
+    uint32_t elapsedMillis;
+};
+
+// Resumable state for the time-sliced scanAndOptimize()
+struct BackgroundScanState {
+    BackgroundScanPhase phase;
+    uint8_t nextAddress;      // Next address to probe during discovery
+    uint8_t clockStep;        // Next step pair to test during the sweep
+    uint8_t riseStep;
+    uint8_t riseFirst;        // Rise-time steps covered by the sweep
+    uint8_t riseLast;
+    uint8_t devicesFound;
+    uint16_t probesDone;
+    uint32_t budgetMicros;    // Time slice per update() call
+    float bestScore;
+    I2CConfig bestConfig;
 };
 
 // Error types
@@ -92,8 +432,48 @@ enum I2CErrorType {
     ERROR_OTHER = 4
 };
 
+// Faults the injector can place in front of the bus
+enum FaultType {
+    FAULT_NONE = 0,
+    FAULT_STUCK_SDA = 1,          // Every transaction fails with a bus error
+    FAULT_BURST_ERRORS = 2,       // param consecutive failures at the window start
+    FAULT_INTERMITTENT_NACK = 3,  // param percent of addresses NACK
+    FAULT_CLOCK_STRETCH = 4,      // param microseconds added; times out beyond the bus timeout
+    FAULT_SPEED_BIT_ERRORS = 5    // Data errors above param Hz, rising with the overshoot
+};
+
+// One scripted fault window
+struct FaultStep {
+    uint32_t startMs;         // From the start of the scenario
+    uint32_t durationMs;
+    FaultType type;
+    uint8_t address;          // 0 = every device
+    uint32_t param;
+};
+
+// Outcome of a scripted scenario
+struct FaultScenarioReport {
+    uint32_t transactions;
+    uint32_t successes;
+    uint32_t injectedFaults;
+    uint32_t collateralFailures;   // Real bus failures while the injector stayed quiet
+    uint32_t worstRecoveryMillis;  // Fault window end to FAULT_RECOVERY_SUCCESS_RUN successes
+    uint32_t unrecoveredWindows;   // Windows still not recovered
+    uint8_t throughputLost;        // Percent of successes lost against the pre-fault rate
+};
+
+class I2CFaultInjector;
+
+// Event hooks - each is a plain function pointer, checked for null before use
+typedef void (*ConfigChangeCallback)(uint32_t oldClockSpeed, uint16_t oldRiseTime,
+                                     uint32_t newClockSpeed, uint16_t newRiseTime);
+typedef void (*ErrorCallback)(uint8_t address, I2CErrorType error);
+typedef void (*RecoveryCallback)(bool entered);
+typedef void (*DeviceCallback)(uint8_t address, bool present);
+
 class SelfAdjustingI2C {
 private:
+    TwoWire* wire;            // Controller this instance drives
     I2CConfig currentConfig;
     I2CConfig bestConfig;
     I2CPerformanceMetrics performanceHistory[LEARNING_WINDOW_SIZE];
@@ -119,13 +499,121 @@ private:
     uint8_t errorHistory[10];
     uint8_t errorHistoryIndex;
     
+    // Search ranges; the step table spans the application bounds narrowed by device limits
+    DynamicRange clockSpeedRange;
+    DynamicRange riseTimeRange;
+    uint32_t clockBoundMin;
+    uint32_t clockBoundMax;
+    uint16_t riseBoundMin;
+    uint16_t riseBoundMax;
+    
+    // Clock ceiling from the analytic bus model; no step above it is tried
+    uint8_t maxClockStep;
+    uint32_t modelMaxClockSpeed;  // 0 = no model
+    
+    // On-chip rise-time measurement
+    uint8_t riseSdaPin;
+    uint8_t riseSclPin;
+    uint32_t riseMeasureInterval; // 0 = no periodic measurement
+    uint32_t lastRiseMeasurement;
+    uint16_t measuredRiseTime;    // ns, 0 = not measured
+    
+    // Pad tuning (internal pull-ups, drive strength)
+    bool padTuning;
+    uint8_t padSdaPin;
+    uint8_t padSclPin;
+    uint8_t padLevel;
+    uint8_t padDriverDrive[2]; // SDA/SCL drive strength the Wire driver left, restored at level 0
+    bool padDriverPullUp[2];   // SDA/SCL pull-ups the Wire driver left (read back on RP2040 only)
+    
+    // Memoised step scores, two 4-bit entries per byte
+    uint8_t stepScoreTable[(DYNAMIC_RANGE_STEPS * DYNAMIC_RANGE_STEPS + 1) / 2];
+    uint32_t lastStepScoreDecay;
+    
+    // Time-sliced background optimization
+    BackgroundScanState scanState;
+    
+    // update() tick state
+    bool updateDriven;        // Set once update() is called; moves learning off the transaction path
+    bool learningSuspended;   // Learning paused by emergency recovery, resumed by update()
+    uint32_t lastUpdateTick;
+    uint32_t lastHistoryRollover;
+    uint32_t lastMarginProbe;
+    uint32_t learnedTransactions; // Transaction count the last learning cycle saw
+    
+    // Transaction timing source
+    TimingSource timingSource;
+    bool hardwareTimerRequested;
+    uint32_t timingTicksPerMicro;
+    uint32_t timingOverheadTicks;   // Cost of a back-to-back tick read, subtracted from every sample
+    
+    // Robust latency statistics for the current configuration
+    LatencyWindow latencyWindow;
+    
+    // Access-pattern profiler
+    bool profilerEnabled;
+    uint8_t profileTxBytes;       // Bytes queued since beginTransmission()
+    uint8_t profileTxRegister;    // First byte queued since beginTransmission()
+    uint8_t profileLastAddress;   // Register last written per address, for the following read
+    uint16_t profileLastRegister;
+#if SAI2C_ENABLE_PROFILER
+    AccessProfileEntry profileTable[PROFILER_SLOTS];
+#endif
+    
+    // Event hooks
+    ConfigChangeCallback configChangeCallback;
+    ErrorCallback errorCallback;
+    RecoveryCallback recoveryCallback;
+    DeviceCallback deviceCallback;
+    uint32_t reportedClockSpeed;  // Last configuration reported to configChangeCallback
+    uint16_t reportedRiseTime;
+    bool probingConfiguration;    // testConfiguration() in progress, don't report transient configs
+    bool recoveryActive;
+    
+    // Sustained FIFO throughput
+    uint32_t fifoSampleRate;
+    uint32_t fifoMinClock;        // Slowest clock that keeps up with the FIFO, Hz (0 = no FIFO seen)
+    uint32_t lastFifoDrainMicros; // Start of the previous drain, 0 = none yet
+    
+    // Expected NACKs (ACK polling, presence probes)
+    bool nackExpected;            // One-shot flag for the next transaction
+    uint32_t expectedNackCount;
+    
+    // Inter-transaction gap tuning
+    bool gapTuning;
+    bool busHeld;                 // Last transaction ended without STOP (repeated start follows)
+    bool shortGapStart;           // Current transaction started soon after the previous STOP
+    uint8_t gappedDeviceCount;    // Devices with a non-zero gap
+    uint32_t lastStopMicros;
+    
+    // Bus timeouts
+    bool adaptiveTimeouts;
+    uint32_t appliedTimeoutMicros; // Last value handed to the core, 0 = never applied
+    
+    // Bounded execution of scanBus()/scanAndOptimize()
+    uint32_t runStartMillis;
+    uint32_t runLimitMillis;      // 0 = unbounded
+    uint32_t lastYieldMillis;
+    BoundedRunResult lastRunResult;
+    
+    // Test hook, null in production
+    I2CFaultInjector* faultInjector;
+    
+    // Decision log ring buffer
+#if SAI2C_ENABLE_DECISION_LOG
+    DecisionLogEntry decisionLog[DECISION_LOG_SIZE];
+#endif
+    uint8_t decisionLogIndex;     // Next slot to write
+    uint8_t decisionLogCount;
+    
 public:
-    SelfAdjustingI2C();
+    SelfAdjustingI2C(TwoWire& bus = Wire);
     
     // Core functionality
     void begin();
     void begin(uint8_t address);
     void end();
+    void update(); // Background maintenance, call regularly from loop()
     
     // Enhanced I2C operations with auto-optimization
     uint8_t requestFrom(uint8_t address, uint8_t quantity);
@@ -134,6 +622,12 @@ public:
     uint8_t endTransmission();
     uint8_t endTransmission(uint8_t stop);
     
+    // Mark a NACK on the next transaction as expected (ACK polling, presence probes):
+    // it is not counted as a failure and cannot trigger recovery
+    void expectNack(bool expected = true);
+    bool probeDevice(uint8_t address);   // true if the device ACKs its address
+    uint32_t getExpectedNackCount() const;
+    
     // Write operations
     size_t write(uint8_t data);
     size_t write(const uint8_t *data, size_t length);
@@ -146,6 +640,7 @@ public:
     
     // Self-adjustment and AI functions
     void enableLearning(bool enable = true);
+    void enableLearningMode(bool enable = true) { enableLearning(enable); }
     void enableAdaptiveMode(bool enable = true);
     void setAdaptationRate(uint8_t rate); // 1-10 (1=conservative, 10=aggressive)
     void forceOptimization();
@@ -161,39 +656,141 @@ public:
     uint8_t getCurrentRiseTimeStep() const;
     I2CPerformanceMetrics getMetrics() const;
     I2CPerformanceMetrics getDeviceMetrics(uint8_t address) const;
+    bool isDevicePresent(uint8_t address) const;
+    uint32_t getMedianTransactionTime() const;   // Median of recent transactions, us
+    uint32_t getRobustTransactionTime() const;   // Trimmed mean of recent transactions, us
     float getPerformanceScore() const;
     bool isInRecoveryMode() const;
     const char* getLastErrorString() const;
+    TimingSource getTimingSource() const;
+    void enableHardwareTimerTiming(bool enable = true); // AVR: takes over Timer1 (no PWM/Servo on its pins)
+    uint8_t getStepScore(uint8_t clockStep, uint8_t riseStep) const; // 0 = unknown, 1-15
+    
+    // Analytic bus model - caps the clock search and starts learning at the prediction
+    uint32_t setBusModel(uint32_t pullUpOhms, uint16_t capacitancePf); // Returns predicted max clock, Hz
+    uint32_t setBusModelFromRiseTime(uint16_t riseTimeNs);
+    void clearBusModel();
+    uint32_t getModelMaxClockSpeed() const;  // 0 = no model
+    uint8_t getMaxClockStep() const;
+    static uint16_t predictRiseTime(uint32_t pullUpOhms, uint16_t capacitancePf);
+    static uint32_t predictMaxClockSpeed(uint16_t riseTimeNs);
+    
+    // On-chip rise-time measurement (needs a CPU cycle counter; returns 0 if unsupported)
+    uint16_t measureRiseTime(uint8_t sdaPin, uint8_t sclPin);  // ns, 30-70% equivalent
+    void enableRiseTimeMonitoring(uint8_t sdaPin, uint8_t sclPin, uint32_t intervalMs = 60000);
+    void disableRiseTimeMonitoring();
+    uint16_t getMeasuredRiseTime() const;
+    
+    // Pad tuning - stronger pulls are tried before the clock is lowered (ESP32, RP2040)
+    void enablePadTuning(uint8_t sdaPin, uint8_t sclPin, bool enable = true);
+    void setPadLevel(uint8_t level);
+    uint8_t getPadLevel() const;
+    void clearStepScores();
     
     // Advanced features
-    void scanAndOptimize(); // Scan all devices and optimize for best overall performance
+    BoundedRunResult scanAndOptimize(uint32_t maxRunTimeMs = 0); // Scan all devices and optimize for best overall performance (0 = no limit)
+    void beginBackgroundOptimization(uint32_t budgetMicros = BACKGROUND_SCAN_BUDGET_US);
+    void cancelBackgroundOptimization();
+    bool isOptimizing() const;
+    uint8_t getOptimizationProgress() const; // 0-100
     void setDeviceSpecificConfig(uint8_t address, uint32_t clockSpeed, uint16_t riseTime);
     void removeDeviceConfig(uint8_t address);
+    
+    // Search bounds - the step table is rebuilt so every step is feasible
+    bool setClockRange(uint32_t minHz, uint32_t maxHz);
+    bool setRiseTimeRange(uint16_t minNs, uint16_t maxNs);
+    void setDeviceMaxClockSpeed(uint8_t address, uint32_t maxHz); // 0 = no limit
+    DynamicRange getClockRange() const;     // After device limits
+    DynamicRange getRiseTimeRange() const;
+    static PlatformCapabilities getPlatformCapabilities();
+    
+    void enableGapTuning(bool enable = true);
+    void setTransactionGap(uint8_t address, uint16_t gapMicros);
+    uint16_t getTransactionGap(uint8_t address) const;
+    void enableAdaptiveTimeouts(bool enable = true);
+    uint32_t getDeviceTimeout(uint8_t address) const; // Microseconds
     void enableEmergencyRecovery(bool enable = true);
     void setCooldownPeriod(uint32_t milliseconds);
     
+    // Event hooks (pass nullptr to remove)
+    void onConfigChange(ConfigChangeCallback callback);
+    void onError(ErrorCallback callback);
+    void onRecovery(RecoveryCallback callback);
+    void onDeviceChange(DeviceCallback callback);
+    
+    // Burst helpers
+    FifoDrainResult drainFifo(const FifoConfig& fifo, SampleRing& ring, uint16_t maxSamples = 0xFFFF);
+    uint32_t getFifoSampleRate() const;   // Smoothed samples/s over recent drains
+    uint32_t getFifoMinClock() const;     // Clock floor learning keeps for the FIFO, Hz (0 = none)
+    ArrayReadResult readArray(const uint8_t* addresses, uint8_t count, uint8_t reg, uint8_t length,
+                              uint8_t* buffer, uint8_t* status = nullptr);
+    EepromWriteResult writeEeprom(uint8_t address, uint16_t memoryAddress, const uint8_t* data, uint16_t length,
+                                  uint8_t pageSize = 32, uint8_t addressBytes = 2, uint16_t writeTimeoutMs = 10);
+    
+    // Fleet configuration import/export
+    size_t getConfigurationExportSize() const;
+    size_t exportConfiguration(uint8_t* buffer, size_t bufferSize) const;       // Returns bytes written
+    bool importConfiguration(const uint8_t* blob, size_t length, bool validateOnBus = true);
+    
+    // Decision log
+    uint8_t getDecisionLog(DecisionLogEntry* entries, uint8_t maxEntries) const; // Oldest first
+    size_t exportDecisionLog(uint8_t* buffer, size_t bufferSize) const;          // Returns bytes written
+    void clearDecisionLog();
+    void printDecisionLog() const;
+    static const char* getDecisionReasonString(DecisionReason reason);
+    
+    // Fault injection for recovery testing (pass nullptr to remove)
+    void setFaultInjector(I2CFaultInjector* injector);
+    
+    // Access-pattern profiler
+    void enableProfiler(bool enable = true);
+    void resetProfiler();
+    uint8_t getTopAccessPatterns(AccessProfileEntry* entries, uint8_t maxEntries) const; // Sorted by bus time
+    void printProfile(uint8_t topN = 8) const;
+    
     // Diagnostic functions
     void printDiagnostics() const;
     void printDeviceConfigs() const;
     bool testConfiguration(uint8_t clockStep, uint8_t riseStep);
-    uint8_t scanBus(); // Returns number of devices found
+    uint8_t scanBus(uint32_t maxRunTimeMs = 0); // Returns number of devices found (0 = no limit)
+    BoundedRunResult getLastRunResult() const;
     
 private:
     // Core AI and optimization functions
     void updatePerformanceMetrics(bool success, uint32_t transactionTime, uint8_t deviceAddress);
+    void finishTransaction(bool success, uint32_t transactionTime, uint8_t deviceAddress, I2CErrorType errorType);
+    void runLearningCycle();
+    static uint16_t fletcher16(const uint8_t* data, size_t length);
+    bool pollForAck(uint8_t address, uint16_t timeoutMs, uint32_t& waitedMicros);
+    void logDecision(DecisionReason reason, uint8_t confidence, uint8_t oldClockStep, uint8_t oldRiseStep,
+                     float currentScore, float bestScore, float trend, float recentErrorRate);
     AIDecision analyzePerformanceAndDecide();
-    void applyAIDecision(const AIDecision& decision);
+    bool applyAIDecision(const AIDecision& decision);
     float calculatePerformanceScore(const I2CPerformanceMetrics& metrics);
+    float calculateSnapshotScore(const I2CPerformanceMetrics& metrics);
+    void recordLatencySample(uint32_t transactionTime);
+    void profileTransaction(uint8_t address, uint16_t reg, uint16_t bytes, uint32_t transactionTime);
+    void resetLatencyWindow();
+    uint8_t sortLatencyWindow(uint16_t* sorted) const;
     float analyzeTrend();
     
     // Configuration management
     void applyConfiguration();
     void applyDeviceConfiguration(uint8_t address);
+    void startTransaction(uint8_t address);
+    bool handleGapFailure(uint8_t deviceAddress, I2CErrorType errorType);
+    void setDeviceGap(DeviceConfig* deviceConfig, uint16_t gapMicros);
+    void updateDeviceLatency(DeviceConfig* deviceConfig, uint32_t transactionTime);
+    uint32_t calculateDeviceTimeout(const DeviceConfig* deviceConfig) const;
+    void applyBusTimeout(uint32_t timeoutMicros);
+    uint8_t injectFault(uint8_t address);
+    bool isSimulated(uint8_t address) const;
     bool isStepValid(uint8_t step);
     void saveCurrentAsBest();
     void restoreBestConfiguration();
     DeviceConfig* findDeviceConfig(uint8_t address);
     void addDeviceConfig(uint8_t address);
+    void setDevicePresent(DeviceConfig* deviceConfig, bool present);
     
     // Error handling and recovery
     void handleError(I2CErrorType errorType);
@@ -208,9 +805,40 @@ private:
     uint8_t calculateStepFromValue(const DynamicRange& range, uint32_t value);
     void updateDynamicRange(DynamicRange& range, uint8_t newStep);
     void optimizeDynamicRanges();
+    void rebuildDynamicRanges();
+    void snapConfigToRanges(I2CConfig& config);
+    
+    // Step score table helpers
+    void setStepScore(uint8_t clockStep, uint8_t riseStep, uint8_t score);
+    void recordStepResult(uint8_t clockStep, uint8_t riseStep, bool success);
+    bool isStepKnownBad(uint8_t clockStep, uint8_t riseStep) const;
+    bool isStepKnownGood(uint8_t clockStep, uint8_t riseStep) const;
+    bool isClockStepKnownBad(uint8_t clockStep) const;
+    uint8_t selectClockStep(uint8_t fromStep, int8_t delta, uint8_t riseStep) const;
+    void decayStepScores();
+    void updateClockCeiling();
+    uint32_t measureLineRiseTicks(uint8_t pin);
+    bool strengthenPads();
+    void applyPadConfiguration();
+    
+    // Bounded execution helpers
+    void beginBoundedRun(uint32_t maxRunTimeMs);
+    bool continueBoundedRun();    // Yields when due; false once the limit is reached
+    void endBoundedRun(bool completed);
+    uint8_t scanAddresses();
+    
+    // Background optimization helpers
+    void serviceBackgroundOptimization();
+    void backgroundDiscoverStep();
+    void backgroundSweepStep();
+    void finishBackgroundOptimization();
+    void runMarginProbe();
     
     // Utility functions
     uint32_t measureTransactionTime();
+    void initTimingSource();
+    uint32_t readTimingTicks() const;
+    uint32_t elapsedMicros(uint32_t startTicks) const;
     
     // Mini AI helper functions
     float calculateStabilityScore();
@@ -233,9 +861,173 @@ private:
 // Global instance (similar to Wire)
 extern SelfAdjustingI2C SmartWire;
 
+// TwoWire constructor arguments for the adaptor's unused base object.
+// TwoWire has no common constructor, so the adaptor is only built on cores
+// whose signature is known; define SAI2C_TWOWIRE_CTOR_ARGS to build it elsewhere.
+#ifndef SAI2C_TWOWIRE_CTOR_ARGS
+#if defined(ESP32)
+#define SAI2C_TWOWIRE_CTOR_ARGS 0
+#elif defined(ARDUINO_ARCH_AVR) || defined(ESP8266)
+#define SAI2C_TWOWIRE_CTOR_ARGS
+#elif defined(ARDUINO_ARCH_MEGAAVR)
+#define SAI2C_TWOWIRE_CTOR_ARGS &TWI0
+#elif defined(ARDUINO_ARCH_SAMD)
+#define SAI2C_TWOWIRE_CTOR_ARGS &PERIPH_WIRE, PIN_WIRE_SDA, PIN_WIRE_SCL
+#elif defined(ARDUINO_ARCH_RP2040) && !defined(ARDUINO_ARCH_MBED)
+#define SAI2C_TWOWIRE_CTOR_ARGS i2c0, PIN_WIRE0_SDA, PIN_WIRE0_SCL
+#endif
+#endif
+
+#ifdef SAI2C_TWOWIRE_CTOR_ARGS
+
+// Drop-in TwoWire for third-party drivers that take a TwoWire*.
+// Every call is forwarded through a SelfAdjustingI2C instance, so driver
+// traffic is tuned and shows up in per-device metrics. Calls made through a
+// plain TwoWire* are only intercepted where the core declares them virtual
+// (ArduinoCore-API based cores: megaAVR, SAMD, nRF52/RP2040 mbed, Renesas,
+// ESP32 3.x); on classic AVR and ESP8266 pass the adaptor by its own type.
+class SelfAdjustingTwoWire : public TwoWire {
+private:
+    SelfAdjustingI2C& smart;
+    
+public:
+    SelfAdjustingTwoWire(SelfAdjustingI2C& target) : TwoWire(SAI2C_TWOWIRE_CTOR_ARGS), smart(target) {}
+    
+    void begin() { smart.begin(); }
+    void begin(uint8_t address) { smart.begin(address); }
+    void end() { smart.end(); }
+    void setClock(uint32_t clock) { (void)clock; } // The optimizer owns the bus clock
+    
+    using TwoWire::beginTransmission;
+    using TwoWire::endTransmission;
+    using TwoWire::requestFrom;
+    using TwoWire::write;
+    
+    void beginTransmission(uint8_t address) { smart.beginTransmission(address); }
+    void beginTransmission(int address) { smart.beginTransmission((uint8_t)address); }
+    uint8_t endTransmission(void) { return smart.endTransmission(); }
+#ifdef ARDUINO_API_VERSION
+    uint8_t endTransmission(bool stopBit) { return smart.endTransmission((uint8_t)stopBit); }
+    size_t requestFrom(uint8_t address, size_t len) { return smart.requestFrom(address, clampLength(len)); }
+    size_t requestFrom(uint8_t address, size_t len, bool stopBit) { return smart.requestFrom(address, clampLength(len), (uint8_t)stopBit); }
+#else
+    uint8_t endTransmission(uint8_t stop) { return smart.endTransmission(stop); }
+    uint8_t requestFrom(uint8_t address, uint8_t quantity) { return smart.requestFrom(address, quantity); }
+    uint8_t requestFrom(uint8_t address, uint8_t quantity, uint8_t stop) { return smart.requestFrom(address, quantity, stop); }
+    uint8_t requestFrom(int address, int quantity) { return smart.requestFrom((uint8_t)address, clampLength(quantity)); }
+    uint8_t requestFrom(int address, int quantity, int stop) { return smart.requestFrom((uint8_t)address, clampLength(quantity), (uint8_t)stop); }
+#endif
+    
+    size_t write(uint8_t data) { return smart.write(data); }
+    size_t write(const uint8_t *data, size_t length) { return smart.write(data, length); }
+    int available() { return smart.available(); }
+    int read() { return smart.read(); }
+    int peek() { return smart.peek(); }
+    void flush() { smart.flush(); }
+    
+private:
+    static uint8_t clampLength(size_t length) { return length > 255 ? 255 : (uint8_t)length; }
+};
+
+// Adaptor over SmartWire for drivers that take a TwoWire*
+extern SelfAdjustingTwoWire SmartTwoWire;
+#endif // SAI2C_TWOWIRE_CTOR_ARGS
+
+// Load balancing across controllers that carry identical devices.
+// Each independent transaction is routed to the bus, among those where the
+// device is present, with the lowest expected completion time: transactions
+// already in flight on that bus times its learned per-transaction latency.
+// With one task the group simply prefers the faster bus; with one RTOS task
+// per controller (ESP32, RP2040) the buses run concurrently and aggregate
+// throughput scales with the number of controllers.
+class SelfAdjustingI2CGroup {
+private:
+    SelfAdjustingI2C* buses[MAX_BUS_GROUP_SIZE];
+    volatile uint8_t inFlight[MAX_BUS_GROUP_SIZE];
+    uint32_t routedTransactions[MAX_BUS_GROUP_SIZE];
+    uint8_t busCount;
+#if SAI2C_GROUP_LOCKING
+    portMUX_TYPE routeMux;                       // Guards the bus choice and in-flight counts
+    SemaphoreHandle_t busLocks[MAX_BUS_GROUP_SIZE]; // Held for a whole routed transaction
+#endif
+    
+public:
+    SelfAdjustingI2CGroup();
+    
+    bool addBus(SelfAdjustingI2C& bus);
+    uint8_t getBusCount() const;
+    
+    // Pick a bus for a device and mark a transaction in flight on it; returns -1 if none has it.
+    // With SAI2C_GROUP_LOCKING, blocks until the bus is free and keeps it locked until releaseBus()
+    int8_t acquireBus(uint8_t address);
+    void releaseBus(int8_t busIndex);
+    SelfAdjustingI2C* getBus(int8_t busIndex) const;
+    
+    // Register read routed to the least-loaded bus; returns the bus index used or -1
+    int8_t readRegisters(uint8_t address, uint8_t reg, uint8_t* buffer, uint8_t length);
+    
+    uint8_t getQueueDepth(uint8_t busIndex) const;
+    uint32_t getRoutedTransactions(uint8_t busIndex) const;
+};
+
+// Scripted fault injection between SelfAdjustingI2C and the Wire core, for
+// exercising error handling and recovery on a real or simulated bus.
+// Faulted transactions never reach the bus; everything else passes through.
+class I2CFaultInjector {
+private:
+    FaultStep steps[MAX_FAULT_STEPS];
+    uint8_t stepCount;
+    uint32_t startMillis;
+    bool running;
+    
+    uint32_t burstRemaining[MAX_FAULT_STEPS];
+    bool windowRecovered[MAX_FAULT_STEPS];
+    uint8_t successRun;
+    uint32_t firstFaultMillis;
+    uint32_t preFaultSuccesses;
+    bool lastInjected;
+    uint8_t simulatedAddress;     // 0 = none
+    FaultScenarioReport report;
+    
+    bool isWindowActive(uint8_t step, uint32_t elapsed) const;
+    
+public:
+    I2CFaultInjector();
+    
+    // Copies the script; windows may overlap
+    bool begin(const FaultStep* script, uint8_t count);
+    void stop();
+    bool isRunning() const;
+    bool isFinished() const;      // Every window has ended
+    
+    // Called by SelfAdjustingI2C around each transaction
+    uint8_t inject(uint8_t address, uint32_t clockSpeed, uint32_t timeoutMicros); // 0 = pass through, else Wire error code
+    void recordOutcome(bool success);
+    
+    // Writes to this address are acknowledged without touching the bus,
+    // taking one FAULT_SIMULATED_FRAME_BITS frame at the current clock
+    void simulateDevice(uint8_t address);   // 0 = off
+    bool simulates(uint8_t address) const;
+    
+    FaultScenarioReport getReport() const;
+    void printReport() const;
+};
+
 // Implementation of key functions
-inline SelfAdjustingI2C::SelfAdjustingI2C() {
+inline SelfAdjustingI2C::SelfAdjustingI2C(TwoWire& bus) : wire(&bus) {
     // Initialize dynamic ranges
+    clockBoundMin = DEFAULT_CLOCK_RANGE_MIN;
+    clockBoundMax = DEFAULT_CLOCK_RANGE_MAX;
+    riseBoundMin = DEFAULT_RISE_RANGE_MIN;
+    riseBoundMax = DEFAULT_RISE_RANGE_MAX;
+    clockSpeedRange.min_value = DEFAULT_CLOCK_RANGE_MIN;
+    clockSpeedRange.max_value = DEFAULT_CLOCK_RANGE_MAX;
+    clockSpeedRange.default_value = DEFAULT_CLOCK_SPEED;
+    clockSpeedRange.current_value = DEFAULT_CLOCK_SPEED;
+    riseTimeRange.min_value = DEFAULT_RISE_RANGE_MIN;
+    riseTimeRange.max_value = DEFAULT_RISE_RANGE_MAX;
+    riseTimeRange.default_value = DEFAULT_RISE_TIME;
+    riseTimeRange.current_value = DEFAULT_RISE_TIME;
     initializeDynamicRanges();
     
     // Initialize with safe defaults
@@ -251,6 +1043,15 @@ inline SelfAdjustingI2C::SelfAdjustingI2C() {
     memset(performanceHistory, 0, sizeof(performanceHistory));
     memset(deviceConfigs, 0, sizeof(deviceConfigs));
     memset(errorHistory, 0, sizeof(errorHistory));
+    memset(stepScoreTable, 0, sizeof(stepScoreTable));
+    memset(&scanState, 0, sizeof(scanState));
+    memset(&latencyWindow, 0, sizeof(latencyWindow));
+#if SAI2C_ENABLE_PROFILER
+    memset(profileTable, 0, sizeof(profileTable));
+#endif
+#if SAI2C_ENABLE_DECISION_LOG
+    memset(decisionLog, 0, sizeof(decisionLog));
+#endif
     
     historyIndex = 0;
     consecutiveErrors = 0;
@@ -267,163 +1068,335 @@ inline SelfAdjustingI2C::SelfAdjustingI2C() {
     currentDeviceAddress = 0;
     lastError = ERROR_NONE;
     errorHistoryIndex = 0;
+    lastStepScoreDecay = 0;
+    maxClockStep = DYNAMIC_RANGE_STEPS - 1;
+    modelMaxClockSpeed = 0;
+    riseSdaPin = 0;
+    riseSclPin = 0;
+    riseMeasureInterval = 0;
+    lastRiseMeasurement = 0;
+    measuredRiseTime = 0;
+    padTuning = false;
+    padSdaPin = 0;
+    padSclPin = 0;
+    padLevel = 0;
+    memset(padDriverDrive, 0, sizeof(padDriverDrive));
+    memset(padDriverPullUp, 0, sizeof(padDriverPullUp));
+    updateDriven = false;
+    learningSuspended = false;
+    lastUpdateTick = 0;
+    lastHistoryRollover = 0;
+    lastMarginProbe = 0;
+    learnedTransactions = 0;
+    timingSource = TIMING_MICROS;
+    hardwareTimerRequested = false;
+    timingTicksPerMicro = 1;
+    timingOverheadTicks = 0;
+    profilerEnabled = false;
+    profileTxBytes = 0;
+    profileTxRegister = 0;
+    profileLastAddress = 0;
+    profileLastRegister = PROFILE_NO_REGISTER;
+    configChangeCallback = nullptr;
+    errorCallback = nullptr;
+    recoveryCallback = nullptr;
+    deviceCallback = nullptr;
+    reportedClockSpeed = currentConfig.clockSpeed;
+    reportedRiseTime = currentConfig.riseTime;
+    probingConfiguration = false;
+    recoveryActive = false;
+    decisionLogIndex = 0;
+    decisionLogCount = 0;
+    fifoSampleRate = 0;
+    fifoMinClock = 0;
+    lastFifoDrainMicros = 0;
+    nackExpected = false;
+    expectedNackCount = 0;
+    gapTuning = false;
+    busHeld = false;
+    shortGapStart = false;
+    gappedDeviceCount = 0;
+    lastStopMicros = 0;
+    adaptiveTimeouts = false;
+    appliedTimeoutMicros = 0;
+    runStartMillis = 0;
+    runLimitMillis = 0;
+    lastYieldMillis = 0;
+    memset(&lastRunResult, 0, sizeof(lastRunResult));
+    faultInjector = nullptr;
     
     // Copy current as best initially
     bestConfig = currentConfig;
 }
 
 inline void SelfAdjustingI2C::begin() {
-    Wire.begin();
+    wire->begin();
     applyConfiguration();
+    applyBusTimeout(DEFAULT_TIMEOUT_MS * 1000UL);
+    initTimingSource();
     
     // Initialize performance tracking
     currentConfig.metrics.lastUpdateTime = millis();
 }
 
 inline void SelfAdjustingI2C::begin(uint8_t address) {
-    Wire.begin(address);
+    wire->begin(address);
     applyConfiguration();
+    applyBusTimeout(DEFAULT_TIMEOUT_MS * 1000UL);
+    initTimingSource();
     
     // Initialize performance tracking
     currentConfig.metrics.lastUpdateTime = millis();
 }
 
 inline void SelfAdjustingI2C::end() {
-    Wire.end();
+    wire->end();
 }
 
 inline uint8_t SelfAdjustingI2C::requestFrom(uint8_t address, uint8_t quantity) {
-    currentDeviceAddress = address;
-    
-    // Apply device-specific configuration if available
-    if (adaptiveMode) {
-        applyDeviceConfiguration(address);
-    }
-    
-    uint32_t startTime = micros();
-    uint8_t result = Wire.requestFrom(address, quantity);
-    uint32_t transactionTime = micros() - startTime;
+    startTransaction(address);
     
-    updatePerformanceMetrics(result > 0, transactionTime, address);
+    uint32_t startTicks = readTimingTicks();
+    uint8_t result = (injectFault(address) == 0) ? wire->requestFrom(address, quantity) : 0;
+    uint32_t transactionTime = elapsedMicros(startTicks);
+    busHeld = false;
     
-    if (result == 0) {
-        handleError(ERROR_TIMEOUT);
-    } else if (learningMode && shouldTriggerAdjustment()) {
-        AIDecision decision = analyzePerformanceAndDecide();
-        if (decision.shouldAdjust) {
-            applyAIDecision(decision);
-        }
+    if (profilerEnabled) {
+        profileTransaction(address, (profileLastAddress == address) ? profileLastRegister : PROFILE_NO_REGISTER,
+                           result, transactionTime);
     }
     
+    // A failed read is an address NACK when the caller is probing for one
+    finishTransaction(result > 0, transactionTime, address, nackExpected ? ERROR_NACK_ADDRESS : ERROR_TIMEOUT);
+    
     return result;
 }
 
 inline uint8_t SelfAdjustingI2C::requestFrom(uint8_t address, uint8_t quantity, uint8_t stop) {
-    currentDeviceAddress = address;
-    
-    // Apply device-specific configuration if available
-    if (adaptiveMode) {
-        applyDeviceConfiguration(address);
-    }
+    startTransaction(address);
     
-    uint32_t startTime = micros();
-    uint8_t result = Wire.requestFrom(address, quantity, stop);
-    uint32_t transactionTime = micros() - startTime;
+    uint32_t startTicks = readTimingTicks();
+    uint8_t result = (injectFault(address) == 0) ? wire->requestFrom(address, quantity, stop) : 0;
+    uint32_t transactionTime = elapsedMicros(startTicks);
+    busHeld = (stop == 0 && result > 0);
     
-    updatePerformanceMetrics(result > 0, transactionTime, address);
-    
-    if (result == 0) {
-        handleError(ERROR_TIMEOUT);
-    } else if (learningMode && shouldTriggerAdjustment()) {
-        AIDecision decision = analyzePerformanceAndDecide();
-        if (decision.shouldAdjust) {
-            applyAIDecision(decision);
-        }
+    if (profilerEnabled) {
+        profileTransaction(address, (profileLastAddress == address) ? profileLastRegister : PROFILE_NO_REGISTER,
+                           result, transactionTime);
     }
     
+    // A failed read is an address NACK when the caller is probing for one
+    finishTransaction(result > 0, transactionTime, address, nackExpected ? ERROR_NACK_ADDRESS : ERROR_TIMEOUT);
+    
     return result;
 }
 
 inline void SelfAdjustingI2C::beginTransmission(uint8_t address) {
-    currentDeviceAddress = address;
+    startTransaction(address);
     
-    // Apply device-specific configuration if available
-    if (adaptiveMode) {
-        applyDeviceConfiguration(address);
-    }
-    
-    Wire.beginTransmission(address);
+    profileTxBytes = 0;
+    wire->beginTransmission(address);
 }
 
 inline uint8_t SelfAdjustingI2C::endTransmission() {
-    uint32_t startTime = micros();
-    uint8_t result = Wire.endTransmission();
-    uint32_t transactionTime = micros() - startTime;
-    
-    updatePerformanceMetrics(result == 0, transactionTime, currentDeviceAddress);
-    
-    if (result != 0) {
-        handleError(classifyError(result));
-    } else if (learningMode && shouldTriggerAdjustment()) {
-        AIDecision decision = analyzePerformanceAndDecide();
-        if (decision.shouldAdjust) {
-            applyAIDecision(decision);
-        }
+    uint32_t startTicks = readTimingTicks();
+    uint8_t result = injectFault(currentDeviceAddress);
+    if (result == 0 && !isSimulated(currentDeviceAddress)) result = wire->endTransmission();
+    uint32_t transactionTime = elapsedMicros(startTicks);
+    busHeld = false;
+    
+    if (profilerEnabled) {
+        uint16_t reg = (profileTxBytes > 0) ? profileTxRegister : PROFILE_NO_REGISTER;
+        profileTransaction(currentDeviceAddress, reg, profileTxBytes, transactionTime);
+        profileLastAddress = currentDeviceAddress;
+        profileLastRegister = reg;
     }
     
+    finishTransaction(result == 0, transactionTime, currentDeviceAddress, classifyError(result));
+    
     return result;
 }
 
 inline uint8_t SelfAdjustingI2C::endTransmission(uint8_t stop) {
-    uint32_t startTime = micros();
-    uint8_t result = Wire.endTransmission(stop);
-    uint32_t transactionTime = micros() - startTime;
-    
-    updatePerformanceMetrics(result == 0, transactionTime, currentDeviceAddress);
-    
-    if (result != 0) {
-        handleError(classifyError(result));
-    } else if (learningMode && shouldTriggerAdjustment()) {
-        AIDecision decision = analyzePerformanceAndDecide();
-        if (decision.shouldAdjust) {
-            applyAIDecision(decision);
-        }
+    uint32_t startTicks = readTimingTicks();
+    uint8_t result = injectFault(currentDeviceAddress);
+    if (result == 0 && !isSimulated(currentDeviceAddress)) result = wire->endTransmission(stop);
+    uint32_t transactionTime = elapsedMicros(startTicks);
+    busHeld = (stop == 0 && result == 0);
+    
+    if (profilerEnabled) {
+        uint16_t reg = (profileTxBytes > 0) ? profileTxRegister : PROFILE_NO_REGISTER;
+        profileTransaction(currentDeviceAddress, reg, profileTxBytes, transactionTime);
+        profileLastAddress = currentDeviceAddress;
+        profileLastRegister = reg;
     }
     
+    finishTransaction(result == 0, transactionTime, currentDeviceAddress, classifyError(result));
+    
     return result;
 }
 
+inline void SelfAdjustingI2C::expectNack(bool expected) {
+    nackExpected = expected;
+}
+
+inline bool SelfAdjustingI2C::probeDevice(uint8_t address) {
+    beginTransmission(address);
+    expectNack();
+    return endTransmission() == 0;
+}
+
+inline uint32_t SelfAdjustingI2C::getExpectedNackCount() const {
+    return expectedNackCount;
+}
+
 inline size_t SelfAdjustingI2C::write(uint8_t data) {
-    return Wire.write(data);
+    if (profilerEnabled) {
+        if (profileTxBytes == 0) profileTxRegister = data;
+        if (profileTxBytes < 255) profileTxBytes++;
+    }
+    return wire->write(data);
 }
 
 inline size_t SelfAdjustingI2C::write(const uint8_t *data, size_t length) {
-    return Wire.write(data, length);
+    if (profilerEnabled && length > 0) {
+        if (profileTxBytes == 0) profileTxRegister = data[0];
+        profileTxBytes = (profileTxBytes + length > 255) ? 255 : profileTxBytes + length;
+    }
+    return wire->write(data, length);
 }
 
 inline int SelfAdjustingI2C::available() {
-    return Wire.available();
+    return wire->available();
 }
 
 inline int SelfAdjustingI2C::read() {
-    return Wire.read();
+    return wire->read();
 }
 
 inline int SelfAdjustingI2C::peek() {
-    return Wire.peek();
+    return wire->peek();
 }
 
 inline void SelfAdjustingI2C::flush() {
-    Wire.flush();
+    wire->flush();
 }
 
 // AI and optimization implementation
+inline void SelfAdjustingI2C::finishTransaction(bool success, uint32_t transactionTime, uint8_t deviceAddress, I2CErrorType errorType) {
+    if (faultInjector != nullptr) {
+        faultInjector->recordOutcome(success);
+    }
+    
+    if (gapTuning && !busHeld) {
+        lastStopMicros = micros();
+    }
+    
+    if (nackExpected) {
+        nackExpected = false;
+        
+        // Polling and presence probes NACK by design - not a bus fault
+        if (!success && (errorType == ERROR_NACK_ADDRESS || errorType == ERROR_NACK_DATA)) {
+            expectedNackCount++;
+            return;
+        }
+    }
+    
+    // Read before the metrics update overwrites it
+    bool afterSuccess = false;
+    if (!success && shortGapStart && gapTuning && adaptiveMode) {
+        DeviceConfig* deviceConfig = findDeviceConfig(deviceAddress);
+        afterSuccess = (deviceConfig != nullptr && deviceConfig->lastSucceeded);
+    }
+    
+    updatePerformanceMetrics(success, transactionTime, deviceAddress);
+    
+    if (!success) {
+        // A device that just worked failing right after a STOP points at its recovery time, not the clock
+        if (afterSuccess && handleGapFailure(deviceAddress, errorType)) {
+            return;
+        }
+        handleError(errorType);
+    } else if (!updateDriven && learningMode && shouldTriggerAdjustment()) {
+        // Legacy sketches that never call update() still learn inline
+        runLearningCycle();
+    }
+}
+
+inline void SelfAdjustingI2C::startTransaction(uint8_t address) {
+    currentDeviceAddress = address;
+    
+    // Apply device-specific configuration if available
+    if (adaptiveMode) {
+        applyDeviceConfiguration(address);
+    }
+    
+    DeviceConfig* deviceConfig = (adaptiveTimeouts || gappedDeviceCount > 0) ? findDeviceConfig(address) : nullptr;
+    
+    if (adaptiveTimeouts) {
+        applyBusTimeout(calculateDeviceTimeout(deviceConfig));
+    }
+    
+    if (!gapTuning || busHeld) {
+        shortGapStart = false; // Repeated start: no bus-free time involved
+        return;
+    }
+    
+    uint32_t idle = micros() - lastStopMicros;
+    
+    if (gappedDeviceCount > 0) {
+        if (deviceConfig != nullptr && deviceConfig->transactionGap > idle) {
+            delayMicroseconds(deviceConfig->transactionGap - idle);
+            idle = deviceConfig->transactionGap;
+        }
+    }
+    
+    shortGapStart = (idle < TRANSACTION_GAP_MAX_US);
+}
+
+inline void SelfAdjustingI2C::runLearningCycle() {
+    uint8_t oldClockStep = currentConfig.clockSpeedStep;
+    uint8_t oldRiseStep = currentConfig.riseTimeStep;
+    
+    AIDecision decision = analyzePerformanceAndDecide();
+    bool applied = true;
+    if (decision.shouldAdjust && decision.clockSpeedDelta < 0 && strengthenPads()) {
+        // Stronger pulls fixed the edges instead; the clock stays where it is
+        decision.reason = "Pads strengthened";
+        decision.reasonCode = REASON_PADS_STRENGTHENED;
+    } else if (decision.shouldAdjust) {
+        applied = applyAIDecision(decision);
+    }
+    
+    // A decision with nowhere to go is neither scored nor logged; the next window decides again
+    if (!applied) {
+        return;
+    }
+    
+    if (decision.stepEvidence != 0) {
+        recordStepResult(oldClockStep, oldRiseStep, decision.stepEvidence > 0);
+    }
+    
+    // Log everything that acted; skip cooldown and no-op evaluations
+    if (decision.reasonCode != REASON_NONE && decision.reasonCode != REASON_COOLDOWN) {
+        logDecision(decision.reasonCode, decision.confidence, oldClockStep, oldRiseStep,
+                    decision.currentScore, decision.bestScore, decision.trend, decision.recentErrorRate);
+    }
+}
+
 inline void SelfAdjustingI2C::updatePerformanceMetrics(bool success, uint32_t transactionTime, uint8_t deviceAddress) {
     // Update global metrics
     if (success) {
         currentConfig.metrics.successfulTransactions++;
         currentConfig.metrics.totalTransactionTime += transactionTime;
+        recordLatencySample(transactionTime);
         consecutiveErrors = 0;
+        updateErrorHistory(ERROR_NONE); // Recent error rate is over transactions, not just errors
+        
+        if (recoveryActive) {
+            recoveryActive = false;
+            if (recoveryCallback != nullptr) recoveryCallback(false);
+        }
     } else {
         currentConfig.metrics.failedTransactions++;
         consecutiveErrors++;
@@ -438,9 +1411,15 @@ inline void SelfAdjustingI2C::updatePerformanceMetrics(bool success, uint32_t tr
         }
         
         if (deviceConfig != nullptr) {
+            deviceConfig->lastSucceeded = success;
             if (success) {
+                deviceConfig->gapStrikes = 0;
                 deviceConfig->config.metrics.successfulTransactions++;
                 deviceConfig->config.metrics.totalTransactionTime += transactionTime;
+                updateDeviceLatency(deviceConfig, transactionTime);
+                if (!deviceConfig->isPresent) {
+                    setDevicePresent(deviceConfig, true);
+                }
             } else {
                 deviceConfig->config.metrics.failedTransactions++;
             }
@@ -463,16 +1442,19 @@ inline void SelfAdjustingI2C::updatePerformanceMetrics(bool success, uint32_t tr
     
     currentConfig.metrics.lastUpdateTime = millis();
     
-    // Update performance score
-    performanceScore = calculatePerformanceScore(currentConfig.metrics);
+    // Update performance score here only when update() isn't doing it
+    if (!updateDriven) {
+        performanceScore = calculatePerformanceScore(currentConfig.metrics);
+    }
 }
 
 inline AIDecision SelfAdjustingI2C::analyzePerformanceAndDecide() {
-    AIDecision decision = {0, 0, 0, false, "No adjustment needed"};
+    AIDecision decision = {0, 0, 0, false, "No adjustment needed", REASON_NONE, 0.0, 0.0, 0.0, 0.0, 0};
     
     // Don't adjust too frequently
     if (millis() - lastAdjustmentTime < adjustmentCooldown) {
         decision.reason = "Cooldown period active";
+        decision.reasonCode = REASON_COOLDOWN;
         return decision;
     }
     
@@ -481,21 +1463,31 @@ inline AIDecision SelfAdjustingI2C::analyzePerformanceAndDecide() {
     float trend = analyzeTrend();
     float recentErrorRate = getRecentErrorRate();
     
+    decision.currentScore = currentScore;
+    decision.bestScore = bestScore;
+    decision.trend = trend;
+    decision.recentErrorRate = recentErrorRate;
+    
     // AI decision logic based on multiple factors
     if (recentErrorRate > 10.0) {
         // High recent error rate - reduce speed for stability
+        decision.stepEvidence = -1;
         decision.clockSpeedDelta = -1;
         decision.riseTimeDelta = 1; // Increase rise time for stability
         decision.confidence = 85;
         decision.shouldAdjust = true;
         decision.reason = "High error rate detected";
+        decision.reasonCode = REASON_HIGH_ERROR_RATE;
     } else if (currentConfig.metrics.errorRate == 0 && 
                currentConfig.metrics.successfulTransactions > 20) {
         // No errors and good sample size - try to optimize
+        decision.stepEvidence = 1;
+        
         if (currentScore > bestScore * 1.15) {
             // Current config is significantly better
             saveCurrentAsBest();
             decision.reason = "New best configuration found";
+            decision.reasonCode = REASON_NEW_BEST;
         }
         
         if (trend > 0.2 && adaptationRate > 6) {
@@ -505,6 +1497,7 @@ inline AIDecision SelfAdjustingI2C::analyzePerformanceAndDecide() {
             decision.confidence = 70;
             decision.shouldAdjust = true;
             decision.reason = "Positive trend, optimizing speed";
+            decision.reasonCode = REASON_POSITIVE_TREND;
         } else if (trend > 0.1 && adaptationRate > 3) {
             // Moderate positive trend - conservative optimization
             decision.clockSpeedDelta = 1;
@@ -512,6 +1505,7 @@ inline AIDecision SelfAdjustingI2C::analyzePerformanceAndDecide() {
             decision.confidence = 60;
             decision.shouldAdjust = true;
             decision.reason = "Moderate optimization";
+            decision.reasonCode = REASON_MODERATE_OPTIMIZATION;
         }
     } else if (currentScore < bestScore * 0.7) {
         // Current performance is significantly worse
@@ -520,6 +1514,7 @@ inline AIDecision SelfAdjustingI2C::analyzePerformanceAndDecide() {
         decision.confidence = 95;
         decision.shouldAdjust = false;
         decision.reason = "Restoring best configuration";
+        decision.reasonCode = REASON_RESTORE_BEST;
         // Restore best configuration instead
         restoreBestConfiguration();
     } else if (consecutiveErrors >= 2) {
@@ -529,28 +1524,44 @@ inline AIDecision SelfAdjustingI2C::analyzePerformanceAndDecide() {
         decision.confidence = 80;
         decision.shouldAdjust = true;
         decision.reason = "Consecutive errors, reducing speed";
+        decision.reasonCode = REASON_CONSECUTIVE_ERRORS;
     }
     
     return decision;
 }
 
-inline void SelfAdjustingI2C::applyAIDecision(const AIDecision& decision) {
+inline bool SelfAdjustingI2C::applyAIDecision(const AIDecision& decision) {
     uint8_t newClockStep = currentConfig.clockSpeedStep;
     uint8_t newRiseStep = currentConfig.riseTimeStep;
     
-    // Apply clock speed delta
-    if (decision.clockSpeedDelta > 0 && newClockStep < DYNAMIC_RANGE_STEPS - 1) {
-        newClockStep++;
-    } else if (decision.clockSpeedDelta < 0 && newClockStep > 0) {
-        newClockStep--;
-    }
+    decayStepScores();
     
+#if SAI2C_HAS_RISE_TIME_CONTROL
     // Apply rise time delta
     if (decision.riseTimeDelta > 0 && newRiseStep < DYNAMIC_RANGE_STEPS - 1) {
         newRiseStep++;
     } else if (decision.riseTimeDelta < 0 && newRiseStep > 0) {
         newRiseStep--;
     }
+#endif
+    
+    // Apply clock speed delta, skipping known-bad steps and jumping to known-good ones
+    newClockStep = selectClockStep(newClockStep, decision.clockSpeedDelta, newRiseStep);
+    
+    // Don't slow below what the FIFO drain needs; overflowing it loses samples for good
+    if (newClockStep < currentConfig.clockSpeedStep && fifoMinClock != 0 &&
+        calculateValueFromStep(clockSpeedRange, newClockStep) < fifoMinClock) {
+        newClockStep = currentConfig.clockSpeedStep;
+    }
+    
+    // Keep the old rise time if the new pair is known to fail
+    if (newRiseStep != currentConfig.riseTimeStep && isStepKnownBad(newClockStep, newRiseStep)) {
+        newRiseStep = currentConfig.riseTimeStep;
+    }
+    
+    if (newClockStep == currentConfig.clockSpeedStep && newRiseStep == currentConfig.riseTimeStep) {
+        return false; // Nothing left to try in the requested direction
+    }
     
     // Validate and apply new configuration
     if (isStepValid(newClockStep) && isStepValid(newRiseStep)) {
@@ -569,8 +1580,11 @@ inline void SelfAdjustingI2C::applyAIDecision(const AIDecision& decision) {
         
         // Reset metrics for new configuration
         memset(&currentConfig.metrics, 0, sizeof(I2CPerformanceMetrics));
+        resetLatencyWindow();
         currentConfig.metrics.lastUpdateTime = millis();
+        return true;
     }
+    return false;
 }
 
 inline float SelfAdjustingI2C::calculatePerformanceScore(const I2CPerformanceMetrics& metrics) {
@@ -584,6 +1598,17 @@ inline float SelfAdjustingI2C::calculatePerformanceScore(const I2CPerformanceMet
     return (reliabilityScore * 0.6) + (efficiencyScore * 0.25) + (stabilityScore * 0.15);
 }
 
+inline float SelfAdjustingI2C::calculateSnapshotScore(const I2CPerformanceMetrics& metrics) {
+    // Reliability and efficiency of a single history entry; no stability term,
+    // which would recurse back into the history
+    uint32_t total = metrics.successfulTransactions + metrics.failedTransactions;
+    if (total == 0 || metrics.successfulTransactions == 0) return 0.0;
+    
+    float reliability = (float)metrics.successfulTransactions / total * 100.0;
+    float efficiency = 100.0 / (1.0 + metrics.averageTransactionTime / 1000.0);
+    return (reliability * 0.7) + (efficiency * 0.3);
+}
+
 inline float SelfAdjustingI2C::calculateReliabilityScore() {
     uint32_t total = currentConfig.metrics.successfulTransactions + 
                     currentConfig.metrics.failedTransactions;
@@ -593,11 +1618,13 @@ inline float SelfAdjustingI2C::calculateReliabilityScore() {
 }
 
 inline float SelfAdjustingI2C::calculateEfficiencyScore() {
-    if (currentConfig.metrics.averageTransactionTime == 0) return 0.0;
+    // Use the outlier-resistant latency rather than the raw mean
+    uint32_t transactionTime = getRobustTransactionTime();
+    if (transactionTime == 0) return 0.0;
     
     // Lower transaction time = higher score, with diminishing returns
     float baseTime = 1000.0; // 1ms baseline
-    float normalizedTime = currentConfig.metrics.averageTransactionTime / baseTime;
+    float normalizedTime = transactionTime / baseTime;
     return max(0.0, 100.0 / (1.0 + normalizedTime));
 }
 
@@ -611,13 +1638,13 @@ inline float SelfAdjustingI2C::calculateStabilityScore() {
     
     // Calculate mean
     for (uint8_t i = 0; i < samples; i++) {
-        mean += calculatePerformanceScore(performanceHistory[i]);
+        mean += calculateSnapshotScore(performanceHistory[i]);
     }
     mean /= samples;
     
     // Calculate variance
     for (uint8_t i = 0; i < samples; i++) {
-        float score = calculatePerformanceScore(performanceHistory[i]);
+        float score = calculateSnapshotScore(performanceHistory[i]);
         variance += (score - mean) * (score - mean);
     }
     variance /= samples;
@@ -631,21 +1658,56 @@ inline void SelfAdjustingI2C::handleError(I2CErrorType errorType) {
     lastErrorTime = millis();
     updateErrorHistory(errorType);
     
+    if (errorCallback != nullptr) {
+        errorCallback(currentDeviceAddress, errorType);
+    }
+    
+    if (errorType == ERROR_NACK_ADDRESS) {
+        DeviceConfig* deviceConfig = findDeviceConfig(currentDeviceAddress);
+        if (deviceConfig != nullptr && deviceConfig->isPresent) {
+            setDevicePresent(deviceConfig, false);
+        }
+    } else if (errorType == ERROR_TIMEOUT && adaptiveTimeouts) {
+        // Back off like a retransmit timer: a slow but healthy device must not keep timing out
+        DeviceConfig* deviceConfig = findDeviceConfig(currentDeviceAddress);
+        if (deviceConfig != nullptr && deviceConfig->latencySamples > 0) {
+            deviceConfig->latencyDeviation = (deviceConfig->latencyDeviation > 0x7FFF) ? 0xFFFF
+                                           : max((uint16_t)(deviceConfig->latencyDeviation * 2), (uint16_t)TIMEOUT_MIN_US);
+        }
+    }
+    
     if (consecutiveErrors >= ERROR_THRESHOLD) {
+        // Remember the failing step so learning doesn't climb back into it
+        recordStepResult(currentConfig.clockSpeedStep, currentConfig.riseTimeStep, false);
+        
+        recoveryActive = true;
+        if (recoveryCallback != nullptr) {
+            recoveryCallback(true);
+        }
+        
+        uint8_t oldClockStep = currentConfig.clockSpeedStep;
+        uint8_t oldRiseStep = currentConfig.riseTimeStep;
+        DecisionReason reason;
+        
         if (emergencyRecovery) {
             emergencyRecoveryProcedure();
+            reason = REASON_EMERGENCY_RECOVERY;
         } else if (adaptiveMode) {
             adaptiveRecovery();
+            reason = REASON_ADAPTIVE_RECOVERY;
         } else {
             incrementalRecovery();
+            reason = REASON_INCREMENTAL_RECOVERY;
         }
+        
+        logDecision(reason, 100, oldClockStep, oldRiseStep, performanceScore, 0.0, trendAnalysis, getRecentErrorRate());
     }
 }
 
 inline void SelfAdjustingI2C::emergencyRecoveryProcedure() {
     // Reset to most conservative settings
-    currentConfig.clockSpeedStep = 0; // Minimum clock speed (75kHz)
-    currentConfig.riseTimeStep = DYNAMIC_RANGE_STEPS - 1; // Maximum rise time (250ns)
+    currentConfig.clockSpeedStep = 0; // Minimum clock speed
+    currentConfig.riseTimeStep = DYNAMIC_RANGE_STEPS - 1; // Maximum rise time
     
     // Update dynamic ranges to conservative values
     updateDynamicRange(clockSpeedRange, 0);
@@ -658,7 +1720,10 @@ inline void SelfAdjustingI2C::emergencyRecoveryProcedure() {
     consecutiveErrors = 0;
     
     // Temporarily disable learning
-    learningMode = false;
+    if (learningMode) {
+        learningMode = false;
+        learningSuspended = true;
+    }
     
     // Re-enable learning after extended cooldown
     lastAdjustmentTime = millis();
@@ -697,6 +1762,7 @@ inline I2CErrorType SelfAdjustingI2C::classifyError(uint8_t wireError) {
         case 2: return ERROR_NACK_ADDRESS;
         case 3: return ERROR_NACK_DATA;
         case 4: return ERROR_OTHER;
+        case 5: return ERROR_TIMEOUT; // Core bus timeout (AVR setWireTimeout, ESP32)
         default: return ERROR_NONE;
     }
 }
@@ -704,10 +1770,23 @@ inline I2CErrorType SelfAdjustingI2C::classifyError(uint8_t wireError) {
 inline void SelfAdjustingI2C::applyConfiguration() {
     setHardwareClockSpeed(currentConfig.clockSpeed);
     setHardwareRiseTime(currentConfig.riseTime);
+    
+    if (probingConfiguration) {
+        return;
+    }
+    
+    if (currentConfig.clockSpeed != reportedClockSpeed || currentConfig.riseTime != reportedRiseTime) {
+        if (configChangeCallback != nullptr) {
+            configChangeCallback(reportedClockSpeed, reportedRiseTime,
+                                 currentConfig.clockSpeed, currentConfig.riseTime);
+        }
+        reportedClockSpeed = currentConfig.clockSpeed;
+        reportedRiseTime = currentConfig.riseTime;
+    }
 }
 
 inline void SelfAdjustingI2C::setHardwareClockSpeed(uint32_t clockSpeed) {
-    Wire.setClock(clockSpeed);
+    wire->setClock(clockSpeed);
 }
 
 inline void SelfAdjustingI2C::setHardwareRiseTime(uint16_t riseTimeNs) {
@@ -729,8 +1808,129 @@ inline void SelfAdjustingI2C::setHardwareRiseTime(uint16_t riseTimeNs) {
 #endif
 }
 
+inline uint8_t SelfAdjustingI2C::injectFault(uint8_t address) {
+    if (faultInjector == nullptr) {
+        return 0;
+    }
+    return faultInjector->inject(address, currentConfig.clockSpeed,
+                                 appliedTimeoutMicros ? appliedTimeoutMicros : DEFAULT_TIMEOUT_MS * 1000UL);
+}
+
+inline bool SelfAdjustingI2C::isSimulated(uint8_t address) const {
+    return faultInjector != nullptr && faultInjector->simulates(address);
+}
+
+inline void SelfAdjustingI2C::applyBusTimeout(uint32_t timeoutMicros) {
+#if defined(ESP32)
+    // Millisecond resolution; round up so the quantised value is compared
+    timeoutMicros = ((timeoutMicros + 999) / 1000) * 1000;
+#endif
+    if (timeoutMicros == appliedTimeoutMicros) {
+        return;
+    }
+    appliedTimeoutMicros = timeoutMicros;
+    
+#if defined(ESP32)
+    wire->setTimeOut((uint16_t)(timeoutMicros / 1000));
+#elif defined(ESP8266)
+    // Bounds how long the master waits on a stretched clock
+    wire->setClockStretchLimit(timeoutMicros);
+#elif defined(WIRE_HAS_TIMEOUT)
+    wire->setWireTimeout(timeoutMicros, true);
+#else
+    // Core has no bus timeout - failures are only detected when the core gives up
+#endif
+}
+
+inline void SelfAdjustingI2C::updateDeviceLatency(DeviceConfig* deviceConfig, uint32_t transactionTime) {
+    int32_t sample = (transactionTime > 0xFFFF) ? 0xFFFF : (int32_t)transactionTime;
+    
+    if (deviceConfig->latencySamples == 0) {
+        deviceConfig->latencyMean = sample;
+        deviceConfig->latencyDeviation = sample / 2;
+    } else {
+        // Integer EWMAs: 1/8 gain on the mean, 1/4 on the deviation
+        int32_t error = sample - deviceConfig->latencyMean;
+        deviceConfig->latencyMean += error / 8;
+        int32_t deviation = deviceConfig->latencyDeviation;
+        deviceConfig->latencyDeviation = deviation + ((error < 0 ? -error : error) - deviation) / 4;
+    }
+    
+    if (deviceConfig->latencySamples < 255) {
+        deviceConfig->latencySamples++;
+    }
+}
+
+inline uint32_t SelfAdjustingI2C::calculateDeviceTimeout(const DeviceConfig* deviceConfig) const {
+    if (deviceConfig == nullptr || deviceConfig->latencySamples < TIMEOUT_MIN_SAMPLES) {
+        return DEFAULT_TIMEOUT_MS * 1000UL;
+    }
+    
+    uint32_t timeout = (uint32_t)deviceConfig->latencyMean +
+                       (uint32_t)TIMEOUT_DEVIATION_FACTOR * deviceConfig->latencyDeviation;
+    return constrain(timeout, (uint32_t)TIMEOUT_MIN_US, (uint32_t)DEFAULT_TIMEOUT_MS * 1000UL);
+}
+
+inline bool SelfAdjustingI2C::continueBoundedRun() {
+    uint32_t now = millis();
+    
+    if (now - lastYieldMillis >= LONG_RUN_YIELD_MS) {
+        lastYieldMillis = now;
+#ifdef ESP32
+        delay(1);
+#else
+        yield();
+#endif
+    }
+    
+    return runLimitMillis == 0 || now - runStartMillis < runLimitMillis;
+}
+
+// Robust latency statistics
+inline void SelfAdjustingI2C::recordLatencySample(uint32_t transactionTime) {
+    latencyWindow.samples[latencyWindow.index] = (transactionTime > 0xFFFF) ? 0xFFFF : (uint16_t)transactionTime;
+    latencyWindow.index = (latencyWindow.index + 1) % LATENCY_WINDOW_SIZE;
+    if (latencyWindow.count < LATENCY_WINDOW_SIZE) {
+        latencyWindow.count++;
+    }
+}
+
+inline void SelfAdjustingI2C::resetLatencyWindow() {
+    latencyWindow.index = 0;
+    latencyWindow.count = 0;
+}
+
+// Timing source
+inline uint32_t SelfAdjustingI2C::readTimingTicks() const {
+#if defined(SAI2C_TIMING_DWT)
+    if (timingSource == TIMING_CYCLE_COUNTER) return SAI2C_DWT_CYCCNT;
+#elif defined(SAI2C_TIMING_CPU_CYCLES)
+    return ESP.getCycleCount();
+#elif defined(SAI2C_TIMING_AVR_TIMER1)
+    if (timingSource == TIMING_HW_TIMER) return TCNT1;
+#endif
+    return micros();
+}
+
+inline uint32_t SelfAdjustingI2C::elapsedMicros(uint32_t startTicks) const {
+    uint32_t ticks = readTimingTicks() - startTicks;
+    if (timingSource == TIMING_HW_TIMER) {
+        ticks &= 0xFFFF; // 16-bit counter, wraps every 32ms at 16MHz
+    }
+    ticks = (ticks > timingOverheadTicks) ? ticks - timingOverheadTicks : 0;
+    // Round to the nearest microsecond
+    return (ticks + timingTicksPerMicro / 2) / timingTicksPerMicro;
+}
+
+inline TimingSource SelfAdjustingI2C::getTimingSource() const {
+    return timingSource;
+}
+
 // Utility functions
 inline bool SelfAdjustingI2C::shouldTriggerAdjustment() {
+    // The background sweep owns the configuration until it completes
+    if (scanState.phase == SCAN_DISCOVER || scanState.phase == SCAN_SWEEP) return false;
+    
     uint32_t totalTransactions = currentConfig.metrics.successfulTransactions + 
                                 currentConfig.metrics.failedTransactions;
     return (totalTransactions > 0) && (totalTransactions % PERFORMANCE_SAMPLES == 0);
@@ -738,6 +1938,7 @@ inline bool SelfAdjustingI2C::shouldTriggerAdjustment() {
 
 inline void SelfAdjustingI2C::enableLearning(bool enable) {
     learningMode = enable;
+    learningSuspended = false;
     if (enable) {
         adjustmentCooldown = 5000; // Reset to normal cooldown
     }
@@ -796,10 +1997,25 @@ inline void SelfAdjustingI2C::addDeviceConfig(uint8_t address) {
         deviceConfigs[deviceCount].address = address;
         deviceConfigs[deviceCount].config = currentConfig;
         deviceConfigs[deviceCount].hasCustomConfig = false;
+        deviceConfigs[deviceCount].isPresent = false;
+        deviceConfigs[deviceCount].transactionGap = 0;
+        deviceConfigs[deviceCount].gapStrikes = 0;
+        deviceConfigs[deviceCount].lastSucceeded = false;
+        deviceConfigs[deviceCount].latencyMean = 0;
+        deviceConfigs[deviceCount].latencyDeviation = 0;
+        deviceConfigs[deviceCount].latencySamples = 0;
+        deviceConfigs[deviceCount].maxClockSpeed = 0;
         deviceCount++;
     }
 }
 
+inline void SelfAdjustingI2C::setDevicePresent(DeviceConfig* deviceConfig, bool present) {
+    deviceConfig->isPresent = present;
+    if (deviceCallback != nullptr) {
+        deviceCallback(deviceConfig->address, present);
+    }
+}
+
 inline void SelfAdjustingI2C::updateErrorHistory(I2CErrorType error) {
     errorHistory[errorHistoryIndex] = (uint8_t)error;
     errorHistoryIndex = (errorHistoryIndex + 1) % 10;
@@ -825,6 +2041,7 @@ inline void SelfAdjustingI2C::saveCurrentAsBest() {
 
 inline void SelfAdjustingI2C::restoreBestConfiguration() {
     currentConfig = bestConfig;
+    resetLatencyWindow();
     applyConfiguration();
 }
 
@@ -838,6 +2055,21 @@ inline uint8_t SelfAdjustingI2C::getCurrentRiseTimeStep() const {
 
 // Dynamic range management function implementations
 inline void SelfAdjustingI2C::initializeDynamicRanges() {
+    // Never lay steps the core cannot realise
+    if (clockSpeedRange.max_value > SAI2C_PLATFORM_MAX_CLOCK) {
+        clockSpeedRange.max_value = SAI2C_PLATFORM_MAX_CLOCK;
+    }
+#if SAI2C_PLATFORM_MIN_CLOCK > 0
+    if (clockSpeedRange.min_value < SAI2C_PLATFORM_MIN_CLOCK) {
+        clockSpeedRange.min_value = SAI2C_PLATFORM_MIN_CLOCK;
+    }
+#endif
+    if (clockSpeedRange.min_value > clockSpeedRange.max_value) {
+        clockSpeedRange.min_value = clockSpeedRange.max_value;
+    }
+    clockSpeedRange.default_value = constrain(clockSpeedRange.default_value,
+                                              clockSpeedRange.min_value, clockSpeedRange.max_value);
+    
     // Calculate step sizes for both ranges
     clockSpeedRange.step_size = (float)(clockSpeedRange.max_value - clockSpeedRange.min_value) / (DYNAMIC_RANGE_STEPS - 1);
     riseTimeRange.step_size = (float)(riseTimeRange.max_value - riseTimeRange.min_value) / (DYNAMIC_RANGE_STEPS - 1);
@@ -871,6 +2103,47 @@ inline void SelfAdjustingI2C::updateDynamicRange(DynamicRange& range, uint8_t ne
     }
 }
 
+inline uint8_t SelfAdjustingI2C::getStepScore(uint8_t clockStep, uint8_t riseStep) const {
+    if (clockStep >= DYNAMIC_RANGE_STEPS || riseStep >= DYNAMIC_RANGE_STEPS) return STEP_SCORE_UNKNOWN;
+    
+    uint16_t index = (uint16_t)clockStep * DYNAMIC_RANGE_STEPS + riseStep;
+    uint8_t packed = stepScoreTable[index >> 1];
+    return (index & 1) ? (packed >> 4) : (packed & 0x0F);
+}
+
+inline void SelfAdjustingI2C::setStepScore(uint8_t clockStep, uint8_t riseStep, uint8_t score) {
+    if (clockStep >= DYNAMIC_RANGE_STEPS || riseStep >= DYNAMIC_RANGE_STEPS) return;
+    
+    uint16_t index = (uint16_t)clockStep * DYNAMIC_RANGE_STEPS + riseStep;
+    uint8_t& packed = stepScoreTable[index >> 1];
+    score &= 0x0F;
+    if (index & 1) {
+        packed = (packed & 0x0F) | (score << 4);
+    } else {
+        packed = (packed & 0xF0) | score;
+    }
+}
+
+inline bool SelfAdjustingI2C::isStepKnownBad(uint8_t clockStep, uint8_t riseStep) const {
+    uint8_t score = getStepScore(clockStep, riseStep);
+    return score != STEP_SCORE_UNKNOWN && score <= STEP_SCORE_BAD_THRESHOLD;
+}
+
+inline bool SelfAdjustingI2C::isStepKnownGood(uint8_t clockStep, uint8_t riseStep) const {
+    return getStepScore(clockStep, riseStep) >= STEP_SCORE_GOOD_THRESHOLD;
+}
+
+inline bool SelfAdjustingI2C::isClockStepKnownBad(uint8_t clockStep) const {
+    // A clock that failed at one rise time is not trusted at another, e.g. after
+    // recovery moves to an unscored rise row
+    for (uint8_t riseStep = 0; riseStep < DYNAMIC_RANGE_STEPS; riseStep++) {
+        if (isStepKnownBad(clockStep, riseStep)) {
+            return true;
+        }
+    }
+    return false;
+}
+
 inline void SelfAdjustingI2C::optimizeDynamicRanges() {
     // Update optimal steps based on current performance
     if (performanceScore > calculatePerformanceScore(bestConfig.metrics)) {